@@ -3515,6 +3515,8 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
                                 debug_line_sect, debug_ranges_sect, eh_frame_sect;
     BOOL                ret = TRUE;
     struct module_format* dwarf2_modfmt;
+    DWORD               start = GetTickCount();
+    unsigned            num_cu = 0;
 
     dwarf2_init_section(&eh_frame,                fmap, ".eh_frame",     NULL,             &eh_frame_sect);
     dwarf2_init_section(&section[section_debug],  fmap, ".debug_info",   ".zdebug_info",   &debug_sect);
@@ -3570,7 +3572,10 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
     while (mod_ctx.data < mod_ctx.end_data)
     {
         dwarf2_parse_compilation_unit(section, dwarf2_modfmt->module, thunks, &mod_ctx, load_offset);
+        num_cu++;
     }
+    TRACE("Parsed %u compilation units for %s in %u ms\n",
+          num_cu, debugstr_w(module->module.ModuleName), GetTickCount() - start);
     dwarf2_modfmt->module->module.SymType = SymDia;
     dwarf2_modfmt->module->module.CVSig = 'D' | ('W' << 8) | ('A' << 16) | ('R' << 24);
     /* FIXME: we could have a finer grain here */
@@ -372,7 +372,8 @@ BOOL module_get_debug(struct module_pair* pair)
     if (pair->effective->module.SymType == SymDeferred)
     {
         BOOL ret;
-        
+        DWORD start = GetTickCount();
+
         if (pair->effective->is_virtual) ret = FALSE;
         else switch (pair->effective->type)
         {
@@ -405,6 +406,8 @@ BOOL module_get_debug(struct module_pair* pair)
         if (!ret) pair->effective->module.SymType = SymNone;
         assert(pair->effective->module.SymType != SymDeferred);
         pair->effective->module.NumSyms = pair->effective->ht_symbols.num_elts;
+        TRACE("Loaded %u symbols for %s in %u ms\n", pair->effective->module.NumSyms,
+              debugstr_w(pair->effective->module.ModuleName), GetTickCount() - start);
     }
     return pair->effective->module.SymType != SymNone;
 }
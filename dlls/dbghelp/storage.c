@@ -374,9 +374,42 @@ void hash_table_destroy(struct hash_table* ht)
 #endif
 }
 
+/* double the number of buckets once the chains get too long
+ * (elements sharing a name stay in insertion order)
+ */
+static void hash_table_grow(struct hash_table* ht)
+{
+    struct hash_table_bucket*   buckets;
+    struct hash_table_elt*      elt;
+    struct hash_table_elt*      next;
+    unsigned                    num_buckets = ht->num_buckets * 2, i, hash;
+
+    buckets = pool_alloc(ht->pool, num_buckets * sizeof(struct hash_table_bucket));
+    if (!buckets) return;
+    memset(buckets, 0, num_buckets * sizeof(struct hash_table_bucket));
+
+    for (i = 0; i < ht->num_buckets; i++)
+    {
+        for (elt = ht->buckets[i].first; elt; elt = next)
+        {
+            next = elt->next;
+            hash = hash_table_hash(elt->name, num_buckets);
+            if (!buckets[hash].first)
+                buckets[hash].first = elt;
+            else
+                buckets[hash].last->next = elt;
+            buckets[hash].last = elt;
+            elt->next = NULL;
+        }
+    }
+    /* the old buckets are released along with the pool */
+    ht->buckets = buckets;
+    ht->num_buckets = num_buckets;
+}
+
 void hash_table_add(struct hash_table* ht, struct hash_table_elt* elt)
 {
-    unsigned                    hash = hash_table_hash(elt->name, ht->num_buckets);
+    unsigned                    hash;
 
     if (!ht->buckets)
     {
@@ -384,6 +417,9 @@ void hash_table_add(struct hash_table* ht, struct hash_table_elt* elt)
         assert(ht->buckets);
         memset(ht->buckets, 0, ht->num_buckets * sizeof(struct hash_table_bucket));
     }
+    else if (ht->num_elts >= ht->num_buckets * 4 && ht->num_buckets < 0x1000000)
+        hash_table_grow(ht);
+    hash = hash_table_hash(elt->name, ht->num_buckets);
 
     /* in some cases, we need to get back the symbols of same name in the order
      * in which they've been inserted. So insert new elements at the end of the list.
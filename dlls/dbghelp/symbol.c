@@ -814,8 +814,8 @@ static BOOL resort_symbols(struct module* module)
             tmp = new;
             num_tmp = delta;
         }
+        /* already sorted above */
         memcpy(tmp, &module->addr_sorttab[module->num_sorttab], delta * sizeof(struct symt_ht*));
-        qsort(tmp, delta, sizeof(struct symt_ht*), symt_cmp_addr);
 
         for (i = delta - 1; i >= 0; i--)
         {
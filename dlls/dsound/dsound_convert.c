@@ -283,6 +283,16 @@ void put_quad2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel
 void mixieee32(float *src, float *dst, unsigned samples)
 {
     TRACE("%p - %p %d\n", src, dst, samples);
+    while (samples >= 4)
+    {
+        dst[0] += src[0];
+        dst[1] += src[1];
+        dst[2] += src[2];
+        dst[3] += src[3];
+        dst += 4;
+        src += 4;
+        samples -= 4;
+    }
     while (samples--)
         *(dst++) += *(src++);
 }
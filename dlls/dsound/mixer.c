@@ -278,6 +278,56 @@ static inline float get_current_sample(const IDirectSoundBufferImpl *dsb,
     return dsb->get(dsb, mixpos % dsb->buflen, channel);
 }
 
+/* Fetch count consecutive samples of one channel, starting at mixpos. The
+ * wraparound check is done once per buffer end instead of once per sample. */
+static float *get_current_samples(const IDirectSoundBufferImpl *dsb, float *out,
+        DWORD mixpos, UINT istride, UINT count, DWORD channel)
+{
+    while (count)
+    {
+        UINT run;
+
+        if (mixpos >= dsb->buflen)
+        {
+            if (!(dsb->playflags & DSBPLAY_LOOPING))
+            {
+                memset(out, 0, count * sizeof(float));
+                return out + count;
+            }
+            mixpos %= dsb->buflen;
+        }
+
+        run = min(count, (dsb->buflen - mixpos + istride - 1) / istride);
+        count -= run;
+        while (run--)
+        {
+            *out++ = dsb->get(dsb, mixpos, channel);
+            mixpos += istride;
+        }
+    }
+    return out;
+}
+
+/* Four independent partial sums let the compiler keep the FIR loop in
+ * vector registers, or at least pipelined, without -ffast-math. */
+static inline float fir_dot(const float *coeffs, const float *samples, int count)
+{
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+    int j;
+
+    for (j = 0; j + 4 <= count; j += 4)
+    {
+        sum0 += coeffs[j] * samples[j];
+        sum1 += coeffs[j + 1] * samples[j + 1];
+        sum2 += coeffs[j + 2] * samples[j + 2];
+        sum3 += coeffs[j + 3] * samples[j + 3];
+    }
+    for (; j < count; j++)
+        sum0 += coeffs[j] * samples[j];
+
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
 static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count)
 {
     UINT istride = dsb->pwfx->nBlockAlign;
@@ -328,9 +378,7 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
      */
     itmp = intermediate;
     for (channel = 0; channel < channels; channel++)
-        for (i = 0; i < required_input; i++)
-            *(itmp++) = get_current_sample(dsb,
-                    dsb->sec_mixpos + i * istride, channel);
+        itmp = get_current_samples(dsb, itmp, dsb->sec_mixpos, istride, required_input, channel);
 
     for(i = 0; i < count; ++i) {
         UINT int_fir_steps = (freqAcc_start + i * dsb->freqAdjustNum) * dsbfirstep / dsb->freqAdjustDen;
@@ -342,20 +390,16 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
 
         int fir_used = 0;
         while (idx < fir_len - 1) {
-            fir_copy[fir_used++] = fir[idx] * (1.0 - rem) + fir[idx + 1] * rem;
-            idx += dsb->firstep;
+            fir_copy[fir_used++] = fir[idx] * (1.0f - rem) + fir[idx + 1] * rem;
+            idx += dsbfirstep;
         }
 
         assert(fir_used <= fir_cachesize);
         assert(ipos + fir_used <= required_input);
 
-        for (channel = 0; channel < dsb->mix_channels; channel++) {
-            int j;
-            float sum = 0.0;
-            float* cache = &intermediate[channel * required_input + ipos];
-            for (j = 0; j < fir_used; j++)
-                sum += fir_copy[j] * cache[j];
-            dsb->put(dsb, i * ostride, channel, sum * dsb->firgain);
+        for (channel = 0; channel < channels; channel++) {
+            const float *cache = &intermediate[channel * required_input + ipos];
+            dsb->put(dsb, i * ostride, channel, fir_dot(fir_copy, cache, fir_used) * dsb->firgain);
         }
     }
 
@@ -446,11 +490,14 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 	}
 }
 
-static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
+/* Apply the volume while accumulating the temporary buffer into the mix
+ * buffer, so that the samples are only walked once. */
+static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, float *mix_buffer, INT frames)
 {
 	INT	i;
 	float vols[DS_MAX_CHANNELS];
 	UINT channels = dsb->device->pwfx->nChannels, chan;
+	const float *src = dsb->device->tmp_buffer;
 
 	TRACE("(%p,%d)\n",dsb,frames);
 	TRACE("left = %x, right = %x\n", dsb->volpan.dwTotalAmpFactor[0],
@@ -459,20 +506,35 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
 	if ((!(dsb->dsbd.dwFlags & DSBCAPS_CTRLPAN) || (dsb->volpan.lPan == 0)) &&
 	    (!(dsb->dsbd.dwFlags & DSBCAPS_CTRLVOLUME) || (dsb->volpan.lVolume == 0)) &&
 	     !(dsb->dsbd.dwFlags & DSBCAPS_CTRL3D))
-		return; /* Nothing to do */
+	{
+		/* No volume to apply */
+		mixieee32(dsb->device->tmp_buffer, mix_buffer, frames * channels);
+		return;
+	}
 
 	if (channels > DS_MAX_CHANNELS)
 	{
 		FIXME("There is no support for %u channels\n", channels);
+		mixieee32(dsb->device->tmp_buffer, mix_buffer, frames * channels);
 		return;
 	}
 
 	for (i = 0; i < channels; ++i)
 		vols[i] = dsb->volpan.dwTotalAmpFactor[i] / ((float)0xFFFF);
 
+	if (channels == 2)
+	{
+		for (i = 0; i < frames; ++i)
+		{
+			mix_buffer[2 * i] += src[2 * i] * vols[0];
+			mix_buffer[2 * i + 1] += src[2 * i + 1] * vols[1];
+		}
+		return;
+	}
+
 	for(i = 0; i < frames; ++i){
 		for(chan = 0; chan < channels; ++chan){
-			dsb->device->tmp_buffer[i * channels + chan] *= vols[chan];
+			mix_buffer[i * channels + chan] += src[i * channels + chan] * vols[chan];
 		}
 	}
 }
@@ -491,7 +553,6 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
  */
 static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
 {
-	float *ibuf;
 	DWORD oldpos;
 
 	TRACE("sec_mixpos=%d/%d\n", dsb->sec_mixpos, dsb->buflen);
@@ -500,12 +561,9 @@ static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer,
 	/* Resample buffer to temporary buffer specifically allocated for this purpose, if needed */
 	oldpos = dsb->sec_mixpos;
 	DSOUND_MixToTemporary(dsb, frames);
-	ibuf = dsb->device->tmp_buffer;
-
-	/* Apply volume if needed */
-	DSOUND_MixerVol(dsb, frames);
 
-	mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
+	/* Apply volume if needed, and mix into the device buffer */
+	DSOUND_MixerVol(dsb, mix_buffer, frames);
 
 	/* check for notification positions */
 	if (dsb->dsbd.dwFlags & DSBCAPS_CTRLPOSITIONNOTIFY &&
@@ -2215,6 +2215,13 @@ static inline BOOL bit_fields_match(const dib_info *d1, const dib_info *d2)
            d1->blue_mask  == d2->blue_mask;
 }
 
+static inline DWORD pixel_555_to_8888(DWORD val)
+{
+    return ((val << 9) & 0xf80000) | ((val << 4) & 0x070000) |
+           ((val << 6) & 0x00f800) | ((val << 1) & 0x000700) |
+           ((val << 3) & 0x0000f8) | ((val >> 2) & 0x000007);
+}
+
 static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel, src_val;
@@ -2287,7 +2294,21 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
         {
             dst_pixel = dst_start;
             src_pixel = src_start;
-            for(x = src_rect->left; x < src_rect->right; x++)
+            /* four pixels at a time, with all the loads before the stores */
+            for(x = src_rect->left; x + 4 <= src_rect->right; x += 4)
+            {
+                DWORD p0 = src_pixel[0] | src_pixel[1] << 8 | src_pixel[2] << 16;
+                DWORD p1 = src_pixel[3] | src_pixel[4] << 8 | src_pixel[5] << 16;
+                DWORD p2 = src_pixel[6] | src_pixel[7] << 8 | src_pixel[8] << 16;
+                DWORD p3 = src_pixel[9] | src_pixel[10] << 8 | src_pixel[11] << 16;
+                dst_pixel[0] = p0;
+                dst_pixel[1] = p1;
+                dst_pixel[2] = p2;
+                dst_pixel[3] = p3;
+                src_pixel += 12;
+                dst_pixel += 4;
+            }
+            for(; x < src_rect->right; x++)
             {
                 RGBQUAD rgb;
                 rgb.rgbBlue  = *src_pixel++;
@@ -2312,13 +2333,18 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
             {
                 dst_pixel = dst_start;
                 src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                for(x = src_rect->left; x + 4 <= src_rect->right; x += 4)
                 {
-                    src_val = *src_pixel++;
-                    *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
-                                   ((src_val << 6) & 0x00f800) | ((src_val << 1) & 0x000700) |
-                                   ((src_val << 3) & 0x0000f8) | ((src_val >> 2) & 0x000007);
+                    DWORD p0 = src_pixel[0], p1 = src_pixel[1], p2 = src_pixel[2], p3 = src_pixel[3];
+                    dst_pixel[0] = pixel_555_to_8888( p0 );
+                    dst_pixel[1] = pixel_555_to_8888( p1 );
+                    dst_pixel[2] = pixel_555_to_8888( p2 );
+                    dst_pixel[3] = pixel_555_to_8888( p3 );
+                    src_pixel += 4;
+                    dst_pixel += 4;
                 }
+                for(; x < src_rect->right; x++)
+                    *dst_pixel++ = pixel_555_to_8888( *src_pixel++ );
                 if(pad_size) memset(dst_pixel, 0, pad_size);
                 dst_start += dst->stride / 4;
                 src_start += src->stride / 2;
@@ -4593,44 +4619,42 @@ static inline BYTE blend_color(BYTE dst, BYTE src, DWORD alpha)
     return (src * alpha + dst * (255 - alpha) + 127) / 255;
 }
 
+/* The 32-bit blending functions work on two channels at a time, each in a 16-bit lane. */
+
+/* (x + 127) / 255 for both lanes, exact for x <= 255 * 255 */
+static inline DWORD div255_lanes( DWORD x )
+{
+    x += 0x007f007f;
+    return ((x + 0x00010001 + ((x >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+}
+
 static inline DWORD blend_argb_constant_alpha( DWORD dst, DWORD src, DWORD alpha )
 {
-    return (blend_color( dst, src, alpha ) |
-            blend_color( dst >> 8, src >> 8, alpha ) << 8 |
-            blend_color( dst >> 16, src >> 16, alpha ) << 16 |
-            blend_color( dst >> 24, src >> 24, alpha ) << 24);
+    DWORD rb = (src & 0x00ff00ff) * alpha + (dst & 0x00ff00ff) * (255 - alpha);
+    DWORD ag = ((src >> 8) & 0x00ff00ff) * alpha + ((dst >> 8) & 0x00ff00ff) * (255 - alpha);
+
+    return div255_lanes( rb ) | div255_lanes( ag ) << 8;
 }
 
 static inline DWORD blend_argb_no_src_alpha( DWORD dst, DWORD src, DWORD alpha )
 {
-    return (blend_color( dst, src, alpha ) |
-            blend_color( dst >> 8, src >> 8, alpha ) << 8 |
-            blend_color( dst >> 16, src >> 16, alpha ) << 16 |
-            blend_color( dst >> 24, 255, alpha ) << 24);
+    return blend_argb_constant_alpha( dst, src | 0xff000000, alpha );
 }
 
 static inline DWORD blend_argb( DWORD dst, DWORD src )
 {
-    BYTE b = (BYTE)src;
-    BYTE g = (BYTE)(src >> 8);
-    BYTE r = (BYTE)(src >> 16);
-    DWORD alpha  = (BYTE)(src >> 24);
-    return ((b     + ((BYTE)dst         * (255 - alpha) + 127) / 255) |
-            (g     + ((BYTE)(dst >> 8)  * (255 - alpha) + 127) / 255) << 8 |
-            (r     + ((BYTE)(dst >> 16) * (255 - alpha) + 127) / 255) << 16 |
-            (alpha + ((BYTE)(dst >> 24) * (255 - alpha) + 127) / 255) << 24);
+    DWORD alpha = 255 - (src >> 24);
+    DWORD rb = (src & 0x00ff00ff) + div255_lanes( (dst & 0x00ff00ff) * alpha );
+    DWORD ag = ((src >> 8) & 0x00ff00ff) + div255_lanes( ((dst >> 8) & 0x00ff00ff) * alpha );
+
+    /* a channel sum above 255 spills into the next channel, as it always has */
+    return rb | ag << 8;
 }
 
 static inline DWORD blend_argb_alpha( DWORD dst, DWORD src, DWORD alpha )
 {
-    BYTE b = ((BYTE)src         * alpha + 127) / 255;
-    BYTE g = ((BYTE)(src >> 8)  * alpha + 127) / 255;
-    BYTE r = ((BYTE)(src >> 16) * alpha + 127) / 255;
-    alpha  = ((BYTE)(src >> 24) * alpha + 127) / 255;
-    return ((b     + ((BYTE)dst         * (255 - alpha) + 127) / 255) |
-            (g     + ((BYTE)(dst >> 8)  * (255 - alpha) + 127) / 255) << 8 |
-            (r     + ((BYTE)(dst >> 16) * (255 - alpha) + 127) / 255) << 16 |
-            (alpha + ((BYTE)(dst >> 24) * (255 - alpha) + 127) / 255) << 24);
+    src = div255_lanes( (src & 0x00ff00ff) * alpha ) | div255_lanes( ((src >> 8) & 0x00ff00ff) * alpha ) << 8;
+    return blend_argb( dst, src );
 }
 
 static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BLENDFUNCTION blend )
@@ -1917,14 +1917,10 @@ static void get_family_names( FT_Face ft_face, WCHAR **name, WCHAR **english, BO
     }
 }
 
-static Family *get_family( FT_Face ft_face, BOOL vertical )
+/* takes ownership of the name strings */
+static Family *get_family_by_name( WCHAR *name, WCHAR *english_name )
 {
-    Family *family;
-    WCHAR *name, *english_name;
-
-    get_family_names( ft_face, &name, &english_name, vertical );
-
-    family = find_family_from_name( name );
+    Family *family = find_family_from_name( name );
 
     if (!family)
     {
@@ -1949,6 +1945,14 @@ static Family *get_family( FT_Face ft_face, BOOL vertical )
     return family;
 }
 
+static Family *get_family( FT_Face ft_face, BOOL vertical )
+{
+    WCHAR *name, *english_name;
+
+    get_family_names( ft_face, &name, &english_name, vertical );
+    return get_family_by_name( name, english_name );
+}
+
 static inline FT_Fixed get_font_version( FT_Face ft_face )
 {
     FT_Fixed version = 0;
@@ -2133,18 +2137,522 @@ static Face *create_face( FT_Face ft_face, FT_Long face_index, const char *file,
     return face;
 }
 
-static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
-                          FT_Long face_index, DWORD flags )
+/* The font file cache records the faces found in every font file loaded while
+ * building the font list, together with the file stamp, so that unchanged files
+ * don't have to be opened again with FreeType when a new session rebuilds the
+ * registry cache. The file is mapped read-only and rewritten by the process that
+ * rebuilds the font list, only re-parsing the files that have changed. */
+
+#define FONT_FILE_CACHE_MAGIC   0x63666657  /* 'Wffc' */
+#define FONT_FILE_CACHE_VERSION 1
+
+/* all structures have the same layout for 32-bit and 64-bit processes */
+struct font_cache_header
 {
-    Face *face;
-    Family *family;
+    DWORD magic;
+    DWORD version;
+    DWORD size;            /* total size of the cache file */
+    LCID  lcid;            /* localized names depend on the system locale */
+    DWORD ft_version;      /* FreeType version used to parse the files */
+    DWORD file_count;
+    DWORD files;           /* offset of the font_cache_file array, sorted by name */
+    DWORD face_count;
+    DWORD faces;           /* offset of the font_cache_face array */
+    DWORD pad;
+};
 
-    face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
-    family = get_family( ft_face, flags & ADDFONT_VERTICAL_FONT );
+struct font_cache_file
+{
+    DWORD     name;        /* offset of the unix file name */
+    DWORD     flags;       /* ADDFONT_ALLOW_BITMAP if the file was loaded with it */
+    ULONGLONG ino;
+    ULONGLONG size;
+    ULONGLONG mtime;
+    ULONGLONG ctime;
+    INT       result;      /* value returned by AddFontToList */
+    DWORD     first_face;
+    DWORD     face_count;
+    DWORD     pad;
+};
+
+struct font_cache_face
+{
+    DWORD         family_name;   /* string offsets, 0 if not present */
+    DWORD         english_name;
+    DWORD         style_name;
+    DWORD         full_name;
+    LONG          face_index;
+    DWORD         ntm_flags;
+    LONG          font_version;
+    DWORD         flags;         /* ADDFONT_VERTICAL_FONT */
+    FONTSIGNATURE fs;
+    DWORD         scalable;
+    SHORT         height;
+    SHORT         width;
+    SHORT         internal_leading;
+    SHORT         pad;
+    LONG          size;
+    LONG          x_ppem;
+    LONG          y_ppem;
+};
+
+struct cached_font_file
+{
+    char                  *name;
+    struct font_cache_file data;
+};
+
+struct cached_font_face
+{
+    WCHAR                 *family_name;
+    WCHAR                 *english_name;
+    WCHAR                 *style_name;
+    WCHAR                 *full_name;
+    struct font_cache_face data;
+};
+
+struct font_cache_builder
+{
+    struct cached_font_file *files;
+    unsigned int             file_count;
+    unsigned int             file_alloc;
+    struct cached_font_face *faces;
+    unsigned int             face_count;
+    unsigned int             face_alloc;
+    struct cached_font_file  current;    /* file being loaded */
+    BOOL                     recording;  /* whether current is valid */
+    BOOL                     dirty;      /* some files weren't found in the cache */
+};
+
+static const struct font_cache_header *font_file_cache;  /* only mapped while building the font list */
+static struct font_cache_builder *font_cache_builder;
+
+static char *get_font_file_cache_path(void)
+{
+    static const char fontcacheA[] = "/fontcache";
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+
+    if (!config_dir) return NULL;
+    if (!(path = HeapAlloc( GetProcessHeap(), 0, strlen(config_dir) + sizeof(fontcacheA) ))) return NULL;
+    strcpy( path, config_dir );
+    strcat( path, fontcacheA );
+    return path;
+}
+
+static const struct font_cache_header *map_font_file_cache(void)
+{
+    const struct font_cache_header *header;
+    struct stat st;
+    void *data;
+    char *path;
+    int fd;
+
+    if (!(path = get_font_file_cache_path())) return NULL;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return NULL;
+
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) || st.st_size > 0x7fffffff)
+    {
+        close( fd );
+        return NULL;
+    }
+    data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (data == MAP_FAILED) return NULL;
+
+    header = data;
+    if (header->magic != FONT_FILE_CACHE_MAGIC || header->version != FONT_FILE_CACHE_VERSION ||
+        header->size != st.st_size || header->lcid != GetSystemDefaultLCID() ||
+        header->ft_version != FT_SimpleVersion ||
+        header->files % sizeof(ULONGLONG) || header->files > header->size ||
+        (header->size - header->files) / sizeof(struct font_cache_file) < header->file_count ||
+        header->faces % sizeof(DWORD) || header->faces > header->size ||
+        (header->size - header->faces) / sizeof(struct font_cache_face) < header->face_count)
+    {
+        TRACE( "ignoring stale font file cache\n" );
+        munmap( data, st.st_size );
+        return NULL;
+    }
+    TRACE( "mapped font file cache with %u files\n", header->file_count );
+    return header;
+}
+
+static void unmap_font_file_cache(void)
+{
+    if (!font_file_cache) return;
+    munmap( (void *)font_file_cache, font_file_cache->size );
+    font_file_cache = NULL;
+}
+
+static const char *font_cache_stringA( DWORD offset )
+{
+    const char *str = (const char *)font_file_cache + offset;
+
+    if (!offset || offset >= font_file_cache->size) return NULL;
+    if (!memchr( str, 0, font_file_cache->size - offset )) return NULL;
+    return str;
+}
+
+static const WCHAR *font_cache_stringW( DWORD offset )
+{
+    const WCHAR *str = (const WCHAR *)((const char *)font_file_cache + offset);
+    DWORD i, len;
+
+    if (!offset || offset >= font_file_cache->size || offset % sizeof(WCHAR)) return NULL;
+    len = (font_file_cache->size - offset) / sizeof(WCHAR);
+    for (i = 0; i < len; i++) if (!str[i]) return str;
+    return NULL;
+}
+
+static int compare_font_cache_file( const char *name1, DWORD flags1, const char *name2, DWORD flags2 )
+{
+    int ret = strcmp( name1, name2 );
+
+    if (!ret) ret = (int)flags1 - (int)flags2;
+    return ret;
+}
+
+static const struct font_cache_file *find_cached_font_file( const char *file, const struct stat *st, DWORD flags )
+{
+    const struct font_cache_file *files, *cached = NULL;
+    const struct font_cache_face *faces;
+    int min = 0, max, pos, res;
+    const char *name;
+    DWORD i;
+
+    if (!font_file_cache) return NULL;
+
+    files = (const struct font_cache_file *)((const char *)font_file_cache + font_file_cache->files);
+    faces = (const struct font_cache_face *)((const char *)font_file_cache + font_file_cache->faces);
+    flags &= ADDFONT_ALLOW_BITMAP;
+    max = font_file_cache->file_count - 1;
+    while (min <= max)
+    {
+        pos = (min + max) / 2;
+        if (!(name = font_cache_stringA( files[pos].name ))) return NULL;
+        if (!(res = compare_font_cache_file( name, files[pos].flags, file, flags )))
+        {
+            cached = &files[pos];
+            break;
+        }
+        if (res < 0) min = pos + 1;
+        else max = pos - 1;
+    }
+    if (!cached) return NULL;
+
+    if (cached->ino != st->st_ino || cached->size != st->st_size ||
+        cached->mtime != st->st_mtime || cached->ctime != st->st_ctime)
+    {
+        TRACE( "%s has changed\n", debugstr_a(file) );
+        return NULL;
+    }
+
+    if (cached->first_face > font_file_cache->face_count ||
+        font_file_cache->face_count - cached->first_face < cached->face_count)
+        return NULL;
+    for (i = 0; i < cached->face_count; i++)
+    {
+        const struct font_cache_face *face = &faces[cached->first_face + i];
+
+        if (!font_cache_stringW( face->family_name ) || !font_cache_stringW( face->style_name ) ||
+            (face->english_name && !font_cache_stringW( face->english_name )) ||
+            (face->full_name && !font_cache_stringW( face->full_name )))
+            return NULL;
+    }
+    return cached;
+}
+
+static void begin_cached_font_file( const char *file, const struct stat *st, DWORD flags, BOOL found )
+{
+    struct font_cache_builder *builder = font_cache_builder;
+
+    if (!found) builder->dirty = TRUE;
+    if (!(builder->current.name = HeapAlloc( GetProcessHeap(), 0, strlen(file) + 1 ))) return;
+    strcpy( builder->current.name, file );
+    memset( &builder->current.data, 0, sizeof(builder->current.data) );
+    builder->current.data.flags = flags & ADDFONT_ALLOW_BITMAP;
+    builder->current.data.ino = st->st_ino;
+    builder->current.data.size = st->st_size;
+    builder->current.data.mtime = st->st_mtime;
+    builder->current.data.ctime = st->st_ctime;
+    builder->current.data.first_face = builder->face_count;
+    builder->recording = TRUE;
+}
+
+/* forget the faces recorded so far, the file will be parsed again next time */
+static void discard_cached_font_file( struct font_cache_builder *builder )
+{
+    while (builder->face_count > builder->current.data.first_face)
+    {
+        struct cached_font_face *face = &builder->faces[--builder->face_count];
+
+        HeapFree( GetProcessHeap(), 0, face->family_name );
+        HeapFree( GetProcessHeap(), 0, face->english_name );
+        HeapFree( GetProcessHeap(), 0, face->style_name );
+        HeapFree( GetProcessHeap(), 0, face->full_name );
+    }
+    HeapFree( GetProcessHeap(), 0, builder->current.name );
+    builder->current.name = NULL;
+    builder->recording = FALSE;
+    builder->dirty = TRUE;
+}
+
+static void end_cached_font_file( INT result )
+{
+    struct font_cache_builder *builder = font_cache_builder;
+
+    if (!builder->recording) return;
+    builder->recording = FALSE;
+
+    if (builder->file_count == builder->file_alloc)
+    {
+        unsigned int new_alloc = max( 64, builder->file_alloc * 2 );
+        struct cached_font_file *new_files;
+
+        if (builder->files)
+            new_files = HeapReAlloc( GetProcessHeap(), 0, builder->files, new_alloc * sizeof(*new_files) );
+        else
+            new_files = HeapAlloc( GetProcessHeap(), 0, new_alloc * sizeof(*new_files) );
+        if (!new_files)
+        {
+            discard_cached_font_file( builder );
+            return;
+        }
+        builder->files = new_files;
+        builder->file_alloc = new_alloc;
+    }
+    builder->current.data.result = result;
+    builder->current.data.face_count = builder->face_count - builder->current.data.first_face;
+    builder->files[builder->file_count++] = builder->current;
+}
+
+static void record_cached_face( const Face *face, const Family *family )
+{
+    struct font_cache_builder *builder = font_cache_builder;
+    struct cached_font_face *cached;
+
+    if (!builder || !builder->recording) return;
+
+    if (builder->face_count == builder->face_alloc)
+    {
+        unsigned int new_alloc = max( 64, builder->face_alloc * 2 );
+        struct cached_font_face *new_faces;
+
+        if (builder->faces)
+            new_faces = HeapReAlloc( GetProcessHeap(), 0, builder->faces, new_alloc * sizeof(*new_faces) );
+        else
+            new_faces = HeapAlloc( GetProcessHeap(), 0, new_alloc * sizeof(*new_faces) );
+        if (!new_faces)
+        {
+            discard_cached_font_file( builder );
+            return;
+        }
+        builder->faces = new_faces;
+        builder->face_alloc = new_alloc;
+    }
+
+    cached = &builder->faces[builder->face_count++];
+    cached->family_name = strdupW( family->FamilyName );
+    cached->english_name = family->EnglishName ? strdupW( family->EnglishName ) : NULL;
+    cached->style_name = strdupW( face->StyleName );
+    cached->full_name = face->FullName ? strdupW( face->FullName ) : NULL;
+    if (!cached->family_name || !cached->style_name ||
+        (family->EnglishName && !cached->english_name) || (face->FullName && !cached->full_name))
+    {
+        discard_cached_font_file( builder );
+        return;
+    }
+
+    memset( &cached->data, 0, sizeof(cached->data) );
+    cached->data.face_index = face->face_index;
+    cached->data.ntm_flags = face->ntmFlags;
+    cached->data.font_version = face->font_version;
+    cached->data.flags = face->flags & ADDFONT_VERTICAL_FONT;
+    cached->data.fs = face->fs;
+    cached->data.scalable = face->scalable;
+    cached->data.height = face->size.height;
+    cached->data.width = face->size.width;
+    cached->data.internal_leading = face->size.internal_leading;
+    cached->data.size = face->size.size;
+    cached->data.x_ppem = face->size.x_ppem;
+    cached->data.y_ppem = face->size.y_ppem;
+}
+
+static int cached_font_file_cmp( const void *p1, const void *p2 )
+{
+    const struct cached_font_file *file1 = p1, *file2 = p2;
+
+    return compare_font_cache_file( file1->name, file1->data.flags, file2->name, file2->data.flags );
+}
+
+static DWORD put_font_cache_string( char *data, DWORD *pos, const void *str, DWORD len )
+{
+    DWORD offset = *pos;
+
+    if (!str) return 0;
+    memcpy( data + offset, str, len );
+    *pos += (len + 3) & ~3;
+    return offset;
+}
+
+static void save_font_file_cache( struct font_cache_builder *builder )
+{
+    struct font_cache_header *header;
+    struct font_cache_file *files;
+    struct font_cache_face *faces;
+    unsigned int i, count = 0;
+    char *data, *path, *tmp;
+    DWORD size, pos;
+    int fd;
+
+    qsort( builder->files, builder->file_count, sizeof(*builder->files), cached_font_file_cmp );
+    for (i = 0; i < builder->file_count; i++)
+        if (!i || cached_font_file_cmp( &builder->files[i - 1], &builder->files[i] )) count++;
+
+    if (!builder->dirty && font_file_cache && font_file_cache->file_count == count) return;
+
+    size = (sizeof(*header) + 7) & ~7;
+    size += builder->file_count * sizeof(*files) + builder->face_count * sizeof(*faces);
+    for (i = 0; i < builder->file_count; i++)
+        size += (strlen( builder->files[i].name ) + 4) & ~3;
+    for (i = 0; i < builder->face_count; i++)
+    {
+        const struct cached_font_face *face = &builder->faces[i];
+
+        size += ((strlenW( face->family_name ) + 2) * sizeof(WCHAR)) & ~3;
+        size += ((strlenW( face->style_name ) + 2) * sizeof(WCHAR)) & ~3;
+        if (face->english_name) size += ((strlenW( face->english_name ) + 2) * sizeof(WCHAR)) & ~3;
+        if (face->full_name) size += ((strlenW( face->full_name ) + 2) * sizeof(WCHAR)) & ~3;
+    }
+
+    if (!(data = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size ))) return;
+
+    header = (struct font_cache_header *)data;
+    header->magic = FONT_FILE_CACHE_MAGIC;
+    header->version = FONT_FILE_CACHE_VERSION;
+    header->lcid = GetSystemDefaultLCID();
+    header->ft_version = FT_SimpleVersion;
+    header->file_count = count;
+    header->files = (sizeof(*header) + 7) & ~7;
+    header->face_count = builder->face_count;
+    header->faces = header->files + count * sizeof(*files);
+    files = (struct font_cache_file *)(data + header->files);
+    faces = (struct font_cache_face *)(data + header->faces);
+    pos = header->faces + builder->face_count * sizeof(*faces);
+
+    for (i = count = 0; i < builder->file_count; i++)
+    {
+        const struct cached_font_file *file = &builder->files[i];
+
+        if (i && !cached_font_file_cmp( &builder->files[i - 1], file )) continue;
+        files[count] = file->data;
+        files[count].name = put_font_cache_string( data, &pos, file->name, strlen( file->name ) + 1 );
+        count++;
+    }
+    for (i = 0; i < builder->face_count; i++)
+    {
+        const struct cached_font_face *face = &builder->faces[i];
+
+        faces[i] = face->data;
+        faces[i].family_name = put_font_cache_string( data, &pos, face->family_name,
+                                                      (strlenW( face->family_name ) + 1) * sizeof(WCHAR) );
+        if (face->english_name)
+            faces[i].english_name = put_font_cache_string( data, &pos, face->english_name,
+                                                           (strlenW( face->english_name ) + 1) * sizeof(WCHAR) );
+        faces[i].style_name = put_font_cache_string( data, &pos, face->style_name,
+                                                     (strlenW( face->style_name ) + 1) * sizeof(WCHAR) );
+        if (face->full_name)
+            faces[i].full_name = put_font_cache_string( data, &pos, face->full_name,
+                                                        (strlenW( face->full_name ) + 1) * sizeof(WCHAR) );
+    }
+    header->size = pos;
+
+    /* write to a temporary file and rename it, processes may have the old one mapped */
+    if ((path = get_font_file_cache_path()))
+    {
+        if ((tmp = HeapAlloc( GetProcessHeap(), 0, strlen(path) + 10 )))
+        {
+            sprintf( tmp, "%s.%x", path, getpid() );
+            if ((fd = open( tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+            {
+                BOOL ret = write( fd, data, header->size ) == header->size;
+
+                close( fd );
+                if (ret && !rename( tmp, path ))
+                    TRACE( "saved font file cache with %u files, %u faces\n", count, builder->face_count );
+                else
+                {
+                    WARN( "failed to save font file cache %s\n", debugstr_a(path) );
+                    unlink( tmp );
+                }
+            }
+            HeapFree( GetProcessHeap(), 0, tmp );
+        }
+        HeapFree( GetProcessHeap(), 0, path );
+    }
+    HeapFree( GetProcessHeap(), 0, data );
+}
+
+static void free_font_cache_builder( struct font_cache_builder *builder )
+{
+    unsigned int i;
+
+    for (i = 0; i < builder->file_count; i++)
+        HeapFree( GetProcessHeap(), 0, builder->files[i].name );
+    for (i = 0; i < builder->face_count; i++)
+    {
+        HeapFree( GetProcessHeap(), 0, builder->faces[i].family_name );
+        HeapFree( GetProcessHeap(), 0, builder->faces[i].english_name );
+        HeapFree( GetProcessHeap(), 0, builder->faces[i].style_name );
+        HeapFree( GetProcessHeap(), 0, builder->faces[i].full_name );
+    }
+    HeapFree( GetProcessHeap(), 0, builder->files );
+    HeapFree( GetProcessHeap(), 0, builder->faces );
+}
+
+static Face *create_face_from_cache( const struct font_cache_face *cached, const char *file,
+                                     const struct stat *st, DWORD flags )
+{
+    Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+
+    if (!face) return NULL;
+    face->refcount = 1;
+    face->StyleName = strdupW( font_cache_stringW( cached->style_name ));
+    face->FullName = cached->full_name ? strdupW( font_cache_stringW( cached->full_name )) : NULL;
+    face->file = towstr( CP_UNIXCP, file );
+    face->dev = st->st_dev;
+    face->ino = st->st_ino;
+    face->font_data_ptr = NULL;
+    face->font_data_size = 0;
+    face->face_index = cached->face_index;
+    face->fs = cached->fs;
+    face->ntmFlags = cached->ntm_flags;
+    face->font_version = cached->font_version;
+    face->scalable = cached->scalable;
+    face->size.height = cached->height;
+    face->size.width = cached->width;
+    face->size.size = cached->size;
+    face->size.x_ppem = cached->x_ppem;
+    face->size.y_ppem = cached->y_ppem;
+    face->size.internal_leading = cached->internal_leading;
+
+    flags |= cached->flags & ADDFONT_VERTICAL_FONT;
+    if (!HIWORD( flags )) flags |= ADDFONT_AA_FLAGS( default_aa_flags );
+    face->flags  = flags;
+    face->family = NULL;
+    face->cached_enum_data = NULL;
+    return face;
+}
+
+static void add_face_to_family( Face *face, Family *family )
+{
+    record_cached_face( face, family );
 
     if (insert_face_in_family_list( face, family ))
     {
-        if (flags & ADDFONT_ADD_TO_CACHE)
+        if (face->flags & ADDFONT_ADD_TO_CACHE)
             add_face_to_cache( face );
 
         TRACE("Added font %s %s\n", debugstr_w(family->FamilyName),
@@ -2154,6 +2662,45 @@ static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr
     release_family( family );
 }
 
+static INT add_cached_font_file( const struct font_cache_file *cached, const char *file,
+                                 const struct stat *st, DWORD flags )
+{
+    const struct font_cache_face *faces;
+    DWORD i;
+
+    TRACE( "using cached faces for %s\n", debugstr_a(file) );
+
+    faces = (const struct font_cache_face *)((const char *)font_file_cache + font_file_cache->faces);
+    for (i = 0; i < cached->face_count; i++)
+    {
+        const struct font_cache_face *cached_face = &faces[cached->first_face + i];
+        const WCHAR *english_name = font_cache_stringW( cached_face->english_name );
+        Face *face = create_face_from_cache( cached_face, file, st, flags );
+        Family *family;
+
+        if (!face)
+        {
+            if (font_cache_builder->recording) discard_cached_font_file( font_cache_builder );
+            continue;
+        }
+        family = get_family_by_name( strdupW( font_cache_stringW( cached_face->family_name )),
+                                     english_name ? strdupW( english_name ) : NULL );
+        add_face_to_family( face, family );
+    }
+    return cached->result;
+}
+
+static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
+                          FT_Long face_index, DWORD flags )
+{
+    Face *face;
+    Family *family;
+
+    face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
+    family = get_family( ft_face, flags & ADDFONT_VERTICAL_FONT );
+    add_face_to_family( face, family );
+}
+
 static FT_Face new_ft_face( const char *file, void *font_data_ptr, DWORD font_data_size,
                             FT_Long face_index, BOOL allow_bitmap )
 {
@@ -2230,36 +2777,12 @@ fail:
     return NULL;
 }
 
-static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_size, DWORD flags)
+static INT add_font_faces(const char *file, void *font_data_ptr, DWORD font_data_size, DWORD flags)
 {
     FT_Face ft_face;
     FT_Long face_index = 0, num_faces;
     INT ret = 0;
 
-    /* we always load external fonts from files - otherwise we would get a crash in update_reg_entries */
-    assert(file || !(flags & ADDFONT_EXTERNAL_FONT));
-
-#ifdef HAVE_CARBON_CARBON_H
-    if(file)
-    {
-        char **mac_list = expand_mac_font(file);
-        if(mac_list)
-        {
-            BOOL had_one = FALSE;
-            char **cursor;
-            for(cursor = mac_list; *cursor; cursor++)
-            {
-                had_one = TRUE;
-                AddFontToList(*cursor, NULL, 0, flags);
-                HeapFree(GetProcessHeap(), 0, *cursor);
-            }
-            HeapFree(GetProcessHeap(), 0, mac_list);
-            if(had_one)
-                return 1;
-        }
-    }
-#endif /* HAVE_CARBON_CARBON_H */
-
     do {
         const DWORD FS_DBCS_MASK = FS_JISJAPAN|FS_CHINESESIMP|FS_WANSUNG|FS_CHINESETRAD|FS_JOHAB;
         FONTSIGNATURE fs;
@@ -2291,6 +2814,49 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
     return ret;
 }
 
+static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_size, DWORD flags)
+{
+    const struct font_cache_file *cached;
+    struct stat st;
+    INT ret;
+
+    /* we always load external fonts from files - otherwise we would get a crash in update_reg_entries */
+    assert(file || !(flags & ADDFONT_EXTERNAL_FONT));
+
+#ifdef HAVE_CARBON_CARBON_H
+    if(file)
+    {
+        char **mac_list = expand_mac_font(file);
+        if(mac_list)
+        {
+            BOOL had_one = FALSE;
+            char **cursor;
+            for(cursor = mac_list; *cursor; cursor++)
+            {
+                had_one = TRUE;
+                AddFontToList(*cursor, NULL, 0, flags);
+                HeapFree(GetProcessHeap(), 0, *cursor);
+            }
+            HeapFree(GetProcessHeap(), 0, mac_list);
+            if(had_one)
+                return 1;
+        }
+    }
+#endif /* HAVE_CARBON_CARBON_H */
+
+    if (file && (flags & ADDFONT_ADD_TO_CACHE) && font_cache_builder && !stat( file, &st ))
+    {
+        cached = find_cached_font_file( file, &st, flags );
+        begin_cached_font_file( file, &st, flags, cached != NULL );
+        if (cached) ret = add_cached_font_file( cached, file, &st, flags );
+        else ret = add_font_faces( file, NULL, 0, flags );
+        end_cached_font_file( ret );
+        return ret;
+    }
+
+    return add_font_faces( file, font_data_ptr, font_data_size, flags );
+}
+
 static int remove_font_resource( const char *file, DWORD flags )
 {
     Family *family, *family_next;
@@ -4388,7 +4954,18 @@ BOOL WineEngInit(void)
     create_font_cache_key(&hkey_font_cache, &disposition);
 
     if(disposition == REG_CREATED_NEW_KEY)
+    {
+        struct font_cache_builder builder;
+
+        memset( &builder, 0, sizeof(builder) );
+        font_file_cache = map_font_file_cache();
+        font_cache_builder = &builder;
         init_font_list();
+        font_cache_builder = NULL;
+        save_font_file_cache( &builder );
+        free_font_cache_builder( &builder );
+        unmap_font_file_cache();
+    }
     else
         load_font_list_from_cache(hkey_font_cache);
 
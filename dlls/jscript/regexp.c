@@ -146,6 +146,16 @@ typedef enum REOp {
 
 #define REOP_IS_SIMPLE(op)  ((op) <= REOP_NCLASS)
 
+/* what positions MatchRegExp has to try, see SetStartHint */
+typedef enum REStartType {
+    RESTART_ANY,        /* every position */
+    RESTART_BOL,        /* beginning of input or line */
+    RESTART_CHAR,       /* occurrences of startChar */
+    RESTART_CHARi,      /* occurrences of startChar, ignoring case */
+    RESTART_CLASS,      /* characters in classList[startClass] */
+    RESTART_PREFIX      /* occurrences of prefix */
+} REStartType;
+
 static const char *reop_names[] = {
     "empty",
     "bol",
@@ -3070,6 +3080,67 @@ good:
     return x;
 }
 
+/*
+ * Find the next position at or after cp where a match can start, using the
+ * hint computed by SetStartHint. Returns NULL if there is none.
+ */
+static const WCHAR *FindMatchStart(REGlobalData *gData, const WCHAR *cp)
+{
+    regexp_t *re = gData->regexp;
+    const WCHAR *end = gData->cpend;
+    RECharSet *charSet;
+    WCHAR ch;
+
+    switch (re->startType) {
+      case RESTART_BOL:
+        if (cp == gData->cpbegin)
+            return cp;
+        if (!(re->flags & REG_MULTILINE))
+            return NULL;
+        for (; cp <= end; cp++) {
+            if (RE_IS_LINE_TERM(cp[-1]))
+                return cp;
+        }
+        return NULL;
+      case RESTART_CHAR:
+        for (; cp < end; cp++) {
+            if (*cp == re->startChar)
+                return cp;
+        }
+        return NULL;
+      case RESTART_CHARi:
+        for (; cp < end; cp++) {
+            if (toupperW(*cp) == re->startChar)
+                return cp;
+        }
+        return NULL;
+      case RESTART_CLASS:
+        charSet = &re->classList[re->startClass];
+        assert(charSet->converted);
+        if (!charSet->length)
+            return NULL;
+        for (; cp < end; cp++) {
+            ch = *cp;
+            if (ch <= charSet->length && (charSet->u.bits[ch >> 3] & (1 << (ch & 0x7))))
+                return cp;
+        }
+        return NULL;
+      case RESTART_PREFIX: {
+        size_t last = re->prefixLength - 1;
+
+        while ((size_t)(end - cp) > last) {
+            ch = cp[last];
+            if (ch == re->prefix[last] && !memcmp(cp, re->prefix, last * sizeof(WCHAR)))
+                return cp;
+            cp += re->prefixShift[ch & 0xff];
+        }
+        return NULL;
+      }
+      default:
+        return cp;
+    }
+}
+
 static match_state_t *MatchRegExp(REGlobalData *gData, match_state_t *x)
 {
     match_state_t *result;
@@ -3082,6 +3153,11 @@ static match_state_t *MatchRegExp(REGlobalData *gData, match_state_t *x)
      * in order to detect end-of-input/line condition.
      */
     for (cp2 = cp; cp2 <= gData->cpend; cp2++) {
+        if (!(gData->regexp->flags & REG_STICKY)) {
+            cp2 = FindMatchStart(gData, cp2);
+            if (!cp2)
+                break;
+        }
         gData->skipped = cp2 - cp;
         x->cp = cp2;
         for (j = 0; j < gData->regexp->parenCount; j++)
@@ -3192,6 +3268,72 @@ void regexp_destroy(regexp_t *re)
     heap_free(re);
 }
 
+/*
+ * Look at the first opcode that has to match for the whole expression to
+ * match and remember what a match start has to look like, so that
+ * MatchRegExp can skip positions that can't match without running the
+ * bytecode on them.
+ */
+static void SetStartHint(regexp_t *re)
+{
+    jsbytecode *pc = re->program;
+    size_t index, length, i;
+    REOp op;
+
+    re->startType = RESTART_ANY;
+
+    op = (REOp) *pc++;
+    while (op == REOP_LPAREN) {
+        pc = ReadCompactIndex(pc, &index);
+        op = (REOp) *pc++;
+    }
+
+    switch (op) {
+      case REOP_BOL:
+        re->startType = RESTART_BOL;
+        break;
+      case REOP_FLAT1:
+        re->startType = RESTART_CHAR;
+        re->startChar = *pc;
+        break;
+      case REOP_UCFLAT1:
+        re->startType = RESTART_CHAR;
+        re->startChar = GET_ARG(pc);
+        break;
+      case REOP_FLAT1i:
+        re->startType = RESTART_CHARi;
+        re->startChar = toupperW(*pc);
+        break;
+      case REOP_UCFLAT1i:
+        re->startType = RESTART_CHARi;
+        re->startChar = toupperW(GET_ARG(pc));
+        break;
+      case REOP_FLATi:
+        pc = ReadCompactIndex(pc, &index);
+        re->startType = RESTART_CHARi;
+        re->startChar = toupperW(re->source[index]);
+        break;
+      case REOP_CLASS:
+        ReadCompactIndex(pc, &re->startClass);
+        re->startType = RESTART_CLASS;
+        break;
+      case REOP_FLAT:
+        pc = ReadCompactIndex(pc, &index);
+        ReadCompactIndex(pc, &length);
+        re->startType = RESTART_PREFIX;
+        re->prefix = re->source + index;
+        re->prefixLength = length;
+        memset(re->prefixShift, min(length, 0xff), sizeof(re->prefixShift));
+        for (i = 0; i + 1 < length; i++) {
+            if (length - 1 - i < re->prefixShift[re->prefix[i] & 0xff])
+                re->prefixShift[re->prefix[i] & 0xff] = length - 1 - i;
+        }
+        break;
+      default:
+        break;
+    }
+}
+
 regexp_t* regexp_new(void *cx, heap_pool_t *pool, const WCHAR *str,
         DWORD str_len, WORD flags, BOOL flat)
 {
@@ -3281,6 +3423,7 @@ regexp_t* regexp_new(void *cx, heap_pool_t *pool, const WCHAR *str,
     re->parenCount = state.parenCount;
     re->source = str;
     re->source_len = str_len;
+    SetStartHint(re);
 
 out:
     heap_pool_clear(mark);
@@ -677,4 +677,19 @@ ok(re.ignoreCase === false, "re.ignoreCase = " + re.ignoreCase);
 ok(re.multiline === true, "re.multiline = " + re.multiline);
 ok(re.global === true, "re.global = " + re.global);
 
+m = "aaaaab aaab".match(/aaab/g);
+ok(m.length === 2, "m.length = " + m.length);
+ok(m[0] === "aaab", "m[0] = " + m[0]);
+m = /(abc)d/.exec("abcabcabcd");
+ok(m.index === 6, "m.index = " + m.index);
+ok(m[1] === "abc", "m[1] = " + m[1]);
+m = "xAbC abc".replace(/abc/gi, "-");
+ok(m === "x- -", "m = " + m);
+m = "a\nb\r\nb".match(/^b/gm);
+ok(m.length === 2, "m.length = " + m.length);
+m = "xab\nb".match(/^b/g);
+ok(m === null, "m = " + m);
+m = "12x3y".replace(/[xy]\d?/g, "-");
+ok(m === "12--", "m = " + m);
+
 reportSuccess();
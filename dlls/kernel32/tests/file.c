@@ -4964,6 +4964,128 @@ static void test_GetFileAttributesExW(void)
     ok(GetLastError() == ERROR_FILE_NOT_FOUND, "Expected error ERROR_FILE_NOT_FOUND, got %u\n", GetLastError());
 }
 
+/* move the last write time of a directory back by the given number of hours */
+static void set_dir_time_back( const char *dir, int hours )
+{
+    FILETIME ft;
+    ULARGE_INTEGER time;
+    HANDLE handle;
+    BOOL ret;
+
+    handle = CreateFileA( dir, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                          NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, 0 );
+    ok( handle != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    GetSystemTimeAsFileTime( &ft );
+    time.u.LowPart = ft.dwLowDateTime;
+    time.u.HighPart = ft.dwHighDateTime;
+    time.QuadPart -= (ULONGLONG)hours * 3600 * 10000000;
+    ft.dwLowDateTime = time.u.LowPart;
+    ft.dwHighDateTime = time.u.HighPart;
+    ret = SetFileTime( handle, NULL, NULL, &ft );
+    ok( ret, "SetFileTime failed %u\n", GetLastError() );
+    CloseHandle( handle );
+}
+
+static void test_case_insensitive_lookup(void)
+{
+    char temp_path[MAX_PATH], dir[MAX_PATH], path[MAX_PATH];
+    HANDLE file;
+    DWORD attrs;
+    BOOL ret;
+    int i;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "tst", 0, dir );
+    DeleteFileA( dir );
+    ret = CreateDirectoryA( dir, NULL );
+    ok( ret, "CreateDirectory failed %u\n", GetLastError() );
+
+    for (i = 0; i < 20; i++)
+    {
+        sprintf( path, "%s\\Mixed Case File %u.Txt", dir, i );
+        file = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+        ok( file != INVALID_HANDLE_VALUE, "%u: CreateFile failed %u\n", i, GetLastError() );
+        CloseHandle( file );
+    }
+    for (i = 0; i < 20; i++)
+    {
+        sprintf( path, "%s\\MIXED case FILE %u.tXT", dir, i );
+        attrs = GetFileAttributesA( path );
+        ok( attrs != INVALID_FILE_ATTRIBUTES, "%u: GetFileAttributes failed %u\n", i, GetLastError() );
+    }
+
+    /* files created or removed right after a lookup must be seen by the next one */
+    sprintf( path, "%s\\mixed case file 20.txt", dir );
+    SetLastError( 0xdeadbeef );
+    attrs = GetFileAttributesA( path );
+    ok( attrs == INVALID_FILE_ATTRIBUTES, "file 20 exists\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "wrong error %u\n", GetLastError() );
+
+    sprintf( path, "%s\\Mixed Case File 20.Txt", dir );
+    file = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    CloseHandle( file );
+    sprintf( path, "%s\\MIXED CASE FILE 20.TXT", dir );
+    attrs = GetFileAttributesA( path );
+    ok( attrs != INVALID_FILE_ATTRIBUTES, "GetFileAttributes failed %u\n", GetLastError() );
+
+    sprintf( path, "%s\\mixed case FILE 3.txt", dir );
+    ret = DeleteFileA( path );
+    ok( ret, "DeleteFile failed %u\n", GetLastError() );
+    SetLastError( 0xdeadbeef );
+    attrs = GetFileAttributesA( path );
+    ok( attrs == INVALID_FILE_ATTRIBUTES, "file 3 still exists\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "wrong error %u\n", GetLastError() );
+
+    /* same thing once the directory hasn't changed for a while, repeated lookups can be cached */
+    set_dir_time_back( dir, 1 );
+    for (i = 0; i < 2; i++)
+    {
+        sprintf( path, "%s\\MIXED case FILE 5.tXT", dir );
+        attrs = GetFileAttributesA( path );
+        ok( attrs != INVALID_FILE_ATTRIBUTES, "%u: GetFileAttributes failed %u\n", i, GetLastError() );
+        sprintf( path, "%s\\mixed case file 21.txt", dir );
+        SetLastError( 0xdeadbeef );
+        attrs = GetFileAttributesA( path );
+        ok( attrs == INVALID_FILE_ATTRIBUTES, "%u: file 21 exists\n", i );
+        ok( GetLastError() == ERROR_FILE_NOT_FOUND, "%u: wrong error %u\n", i, GetLastError() );
+    }
+
+    sprintf( path, "%s\\mixed CASE file 5.txt", dir );
+    sprintf( temp_path, "%s\\Mixed Case File 21.Txt", dir );
+    ret = MoveFileA( path, temp_path );
+    ok( ret, "MoveFile failed %u\n", GetLastError() );
+    SetLastError( 0xdeadbeef );
+    attrs = GetFileAttributesA( path );
+    ok( attrs == INVALID_FILE_ATTRIBUTES, "file 5 still exists\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "wrong error %u\n", GetLastError() );
+    sprintf( path, "%s\\MIXED CASE FILE 21.TXT", dir );
+    attrs = GetFileAttributesA( path );
+    ok( attrs != INVALID_FILE_ATTRIBUTES, "GetFileAttributes failed %u\n", GetLastError() );
+
+    set_dir_time_back( dir, 2 );
+    sprintf( path, "%s\\mixed case file 21.txt", dir );
+    attrs = GetFileAttributesA( path );
+    ok( attrs != INVALID_FILE_ATTRIBUTES, "GetFileAttributes failed %u\n", GetLastError() );
+    sprintf( path, "%s\\Mixed Case File 5.Txt", dir );
+    file = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    CloseHandle( file );
+    sprintf( path, "%s\\MIXED CASE file 5.TXT", dir );
+    attrs = GetFileAttributesA( path );
+    ok( attrs != INVALID_FILE_ATTRIBUTES, "GetFileAttributes failed %u\n", GetLastError() );
+
+    for (i = 0; i <= 21; i++)
+    {
+        sprintf( path, "%s\\Mixed Case File %u.Txt", dir, i );
+        ret = DeleteFileA( path );
+        ok( ret || (i == 3 && GetLastError() == ERROR_FILE_NOT_FOUND),
+            "%u: DeleteFile failed %u\n", i, GetLastError() );
+    }
+    ret = RemoveDirectoryA( dir );
+    ok( ret, "RemoveDirectory failed %u\n", GetLastError() );
+}
+
 START_TEST(file)
 {
     InitFunctionPointers();
@@ -5022,4 +5144,5 @@ START_TEST(file)
     test_GetFinalPathNameByHandleW();
     test_SetFileInformationByHandle();
     test_GetFileAttributesExW();
+    test_case_insensitive_lookup();
 }
@@ -39,6 +39,7 @@
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
+static BOOL (WINAPI *pHeapSetInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 static BOOL (WINAPI *pGetPhysicallyInstalledSystemMemory)(ULONGLONG *);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
 
@@ -892,6 +893,88 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static void test_low_fragmentation_heap(void)
+{
+    BYTE *ptrs[256];
+    HANDLE heap;
+    ULONG info;
+    SIZE_T size;
+    BOOL ret;
+    int i, j;
+
+    pHeapSetInformation = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "HeapSetInformation");
+    if (!pHeapSetInformation || !pHeapQueryInformation)
+    {
+        win_skip("HeapSetInformation is not available\n");
+        return;
+    }
+
+    /* not supported on non-serialized heaps */
+    heap = HeapCreate( HEAP_NO_SERIALIZE, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed %u\n", GetLastError() );
+    info = 2;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation succeeded\n" );
+    HeapDestroy( heap );
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed %u\n", GetLastError() );
+    info = 2;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    if (!ret)
+    {
+        skip("low-fragmentation heap not available, probably running with heap debugging\n");
+        HeapDestroy( heap );
+        return;
+    }
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 2, "expected 2, got %u\n", info );
+
+    for (j = 0; j < 3; j++)
+    {
+        for (i = 0; i < ARRAY_SIZE(ptrs); i++)
+        {
+            size = 1 + (i * 13 + j) % 700;
+            ptrs[i] = HeapAlloc( heap, HEAP_ZERO_MEMORY, size );
+            ok( ptrs[i] != NULL, "%d/%d: HeapAlloc failed\n", j, i );
+            ok( HeapSize( heap, 0, ptrs[i] ) == size, "%d/%d: wrong size %lu/%lu\n",
+                j, i, HeapSize( heap, 0, ptrs[i] ), size );
+            ok( !ptrs[i][0] && !ptrs[i][size - 1], "%d/%d: block not zeroed\n", j, i );
+            memset( ptrs[i], 0xcc, size );
+        }
+        ok( HeapValidate( heap, 0, NULL ), "%d: HeapValidate failed\n", j );
+
+        /* free every other block and reallocate them with a different size */
+        for (i = 0; i < ARRAY_SIZE(ptrs); i += 2)
+        {
+            ret = HeapFree( heap, 0, ptrs[i] );
+            ok( ret, "%d/%d: HeapFree failed\n", j, i );
+        }
+        ok( HeapValidate( heap, 0, NULL ), "%d: HeapValidate failed\n", j );
+        for (i = 0; i < ARRAY_SIZE(ptrs); i += 2)
+        {
+            size = 1 + (i * 7 + j) % 500;
+            ptrs[i] = HeapAlloc( heap, HEAP_ZERO_MEMORY, size );
+            ok( ptrs[i] != NULL, "%d/%d: HeapAlloc failed\n", j, i );
+            ok( HeapSize( heap, 0, ptrs[i] ) == size, "%d/%d: wrong size %lu/%lu\n",
+                j, i, HeapSize( heap, 0, ptrs[i] ), size );
+            ok( !ptrs[i][0] && !ptrs[i][size - 1], "%d/%d: block not zeroed\n", j, i );
+        }
+
+        for (i = 0; i < ARRAY_SIZE(ptrs); i++)
+        {
+            ret = HeapFree( heap, 0, ptrs[i] );
+            ok( ret, "%d/%d: HeapFree failed\n", j, i );
+        }
+        ok( HeapValidate( heap, 0, NULL ), "%d: HeapValidate failed\n", j );
+    }
+
+    ret = HeapDestroy( heap );
+    ok( ret, "HeapDestroy failed %u\n", GetLastError() );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1245,6 +1328,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_low_fragmentation_heap();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
@@ -68,7 +68,56 @@ static void test_timer(void)
     CloseHandle( handle );
 }
 
+static void test_many_timers(void)
+{
+    HANDLE timers[512];
+    LARGE_INTEGER due;
+    DWORD ret;
+    BOOL r;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(timers); i++)
+    {
+        timers[i] = CreateWaitableTimerA( NULL, TRUE, NULL );
+        ok( timers[i] != NULL, "%d: CreateWaitableTimer failed with error %u\n", i, GetLastError() );
+        due.QuadPart = -10000 * (1 + (i * 37) % 50);
+        r = SetWaitableTimer( timers[i], &due, 0, NULL, NULL, FALSE );
+        ok( r, "%d: SetWaitableTimer failed with error %u\n", i, GetLastError() );
+    }
+
+    /* cancel some timers and move some others around */
+    for (i = 0; i < ARRAY_SIZE(timers); i++)
+    {
+        if (i % 3 == 1)
+        {
+            r = CancelWaitableTimer( timers[i] );
+            ok( r, "%d: CancelWaitableTimer failed with error %u\n", i, GetLastError() );
+        }
+        else if (i % 3 == 2)
+        {
+            due.QuadPart = -10000 * (1 + (i * 11) % 30);
+            r = SetWaitableTimer( timers[i], &due, 0, NULL, NULL, FALSE );
+            ok( r, "%d: SetWaitableTimer failed with error %u\n", i, GetLastError() );
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(timers); i++)
+    {
+        if (i % 3 == 1) continue;
+        ret = WaitForSingleObject( timers[i], 5000 );
+        ok( ret == WAIT_OBJECT_0, "%d: WaitForSingleObject returned %u\n", i, ret );
+    }
+    for (i = 1; i < ARRAY_SIZE(timers); i += 3)
+    {
+        ret = WaitForSingleObject( timers[i], 0 );
+        ok( ret == WAIT_TIMEOUT, "%d: WaitForSingleObject returned %u\n", i, ret );
+    }
+
+    for (i = 0; i < ARRAY_SIZE(timers); i++) CloseHandle( timers[i] );
+}
+
 START_TEST(timer)
 {
     test_timer();
+    test_many_timers();
 }
@@ -39,8 +39,6 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(msidb);
 
-#define MSITABLE_HASH_TABLE_SIZE 37
-
 typedef struct tagMSICOLUMNHASHENTRY
 {
     struct tagMSICOLUMNHASHENTRY *next;
@@ -48,6 +46,15 @@ typedef struct tagMSICOLUMNHASHENTRY
     UINT row;
 } MSICOLUMNHASHENTRY;
 
+/* index of the values of a column, allocated as a single block */
+typedef struct tagMSICOLUMNHASH
+{
+    UINT bucket_mask;              /* number of buckets minus one */
+    UINT capacity;                 /* number of rows the entries can hold */
+    MSICOLUMNHASHENTRY **buckets;
+    MSICOLUMNHASHENTRY *entries;   /* entry of each row, indexed by row number */
+} MSICOLUMNHASH;
+
 typedef struct tagMSICOLUMNINFO
 {
     LPCWSTR tablename;
@@ -57,7 +64,7 @@ typedef struct tagMSICOLUMNINFO
     UINT    offset;
     INT     ref_count;
     BOOL    temporary;
-    MSICOLUMNHASHENTRY **hash_table;
+    MSICOLUMNHASH *hash_table;
 } MSICOLUMNINFO;
 
 struct tagMSITABLE
@@ -1165,8 +1172,82 @@ static UINT TABLE_fetch_stream( struct tagMSIVIEW *view, UINT row, UINT col, ISt
     return r;
 }
 
+static inline UINT column_hash_bucket( const MSICOLUMNHASH *hash, UINT value )
+{
+    return (value ^ (value >> 16)) & hash->bucket_mask;
+}
+
+/* keep each chain sorted by row, lookups must return rows in table order */
+static void column_hash_link( MSICOLUMNHASH *hash, MSICOLUMNHASHENTRY *entry )
+{
+    MSICOLUMNHASHENTRY **ptr = &hash->buckets[column_hash_bucket( hash, entry->value )];
+
+    while (*ptr && (*ptr)->row < entry->row) ptr = &(*ptr)->next;
+    entry->next = *ptr;
+    *ptr = entry;
+}
+
+static void column_hash_unlink( MSICOLUMNHASH *hash, MSICOLUMNHASHENTRY *entry )
+{
+    MSICOLUMNHASHENTRY **ptr = &hash->buckets[column_hash_bucket( hash, entry->value )];
+
+    while (*ptr != entry) ptr = &(*ptr)->next;
+    *ptr = entry->next;
+}
+
+static void free_column_hashes( MSITABLEVIEW *tv )
+{
+    UINT i;
+
+    for (i = 0; i < tv->num_cols; i++)
+    {
+        msi_free( tv->columns[i].hash_table );
+        tv->columns[i].hash_table = NULL;
+    }
+}
+
+static UINT build_column_hash( MSITABLEVIEW *tv, UINT col )
+{
+    UINT i, r, num_rows = tv->table->row_count, size = 64;
+    MSICOLUMNHASH *hash;
+
+    /* leave room for appending rows without rebuilding the index */
+    while (size < num_rows * 2) size *= 2;
+
+    /* allocate contiguous memory for the table and its entries so we
+     * don't have to do an expensive cleanup */
+    hash = msi_alloc( sizeof(*hash) + size * (sizeof(*hash->buckets) + sizeof(*hash->entries)) );
+    if (!hash)
+        return ERROR_OUTOFMEMORY;
+
+    hash->bucket_mask = size - 1;
+    hash->capacity = size;
+    hash->buckets = (MSICOLUMNHASHENTRY **)(hash + 1);
+    hash->entries = (MSICOLUMNHASHENTRY *)(hash->buckets + size);
+    memset( hash->buckets, 0, size * sizeof(*hash->buckets) );
+
+    /* link the rows in reverse so that each one goes to the head of its chain */
+    for (i = num_rows; i > 0; i--)
+    {
+        MSICOLUMNHASHENTRY *entry = &hash->entries[i - 1];
+
+        r = TABLE_fetch_int( &tv->view, i - 1, col, &entry->value );
+        if (r != ERROR_SUCCESS)
+        {
+            msi_free( hash );
+            return r;
+        }
+        entry->row = i - 1;
+        column_hash_link( hash, entry );
+    }
+
+    tv->columns[col-1].hash_table = hash;
+    return ERROR_SUCCESS;
+}
+
 static UINT TABLE_set_int( MSITABLEVIEW *tv, UINT row, UINT col, UINT val )
 {
+    MSICOLUMNHASH *hash;
     UINT offset, n, i;
 
     if( !tv->table )
@@ -1185,9 +1266,6 @@ static UINT TABLE_set_int( MSITABLEVIEW *tv, UINT row, UINT col, UINT val )
         return ERROR_FUNCTION_FAILED;
     }
 
-    msi_free( tv->columns[col-1].hash_table );
-    tv->columns[col-1].hash_table = NULL;
-
     n = bytes_per_column( tv->db, &tv->columns[col - 1], LONG_STR_BYTES );
     if ( n != 2 && n != 3 && n != 4 )
     {
@@ -1199,6 +1277,15 @@ static UINT TABLE_set_int( MSITABLEVIEW *tv, UINT row, UINT col, UINT val )
     for ( i = 0; i < n; i++ )
         tv->table->data[row][offset + i] = (val >> i * 8) & 0xff;
 
+    if ((hash = tv->columns[col-1].hash_table))
+    {
+        MSICOLUMNHASHENTRY *entry = &hash->entries[row];
+
+        column_hash_unlink( hash, entry );
+        TABLE_fetch_int( &tv->view, row, col, &entry->value );
+        column_hash_link( hash, entry );
+    }
+
     return ERROR_SUCCESS;
 }
 
@@ -1414,7 +1501,7 @@ static UINT table_create_new_row( struct tagMSIVIEW *view, UINT *num, BOOL tempo
     MSITABLEVIEW *tv = (MSITABLEVIEW*)view;
     BYTE **p, *row;
     BOOL *b;
-    UINT sz;
+    UINT sz, i;
     BYTE ***data_ptr;
     BOOL **data_persist_ptr;
     UINT *row_count;
@@ -1465,6 +1552,30 @@ static UINT table_create_new_row( struct tagMSIVIEW *view, UINT *num, BOOL tempo
 
     (*row_count)++;
 
+    /* an appended row can be added to the hash tables, otherwise the rows
+     * get shifted and the tables need to be rebuilt */
+    for (i = 0; i < tv->num_cols; i++)
+    {
+        MSICOLUMNHASH *hash = tv->columns[i].hash_table;
+
+        if (!hash)
+            continue;
+
+        if (*num == *row_count - 1 && *row_count <= hash->capacity)
+        {
+            MSICOLUMNHASHENTRY *entry = &hash->entries[*num];
+
+            entry->value = 0;
+            entry->row = *num;
+            column_hash_link( hash, entry );
+        }
+        else
+        {
+            msi_free( hash );
+            tv->columns[i].hash_table = NULL;
+        }
+    }
+
     return ERROR_SUCCESS;
 }
 
@@ -1696,11 +1807,7 @@ static UINT TABLE_delete_row( struct tagMSIVIEW *view, UINT row )
     tv->table->row_count--;
 
     /* reset the hash tables */
-    for (i = 0; i < tv->num_cols; i++)
-    {
-        msi_free( tv->columns[i].hash_table );
-        tv->columns[i].hash_table = NULL;
-    }
+    free_column_hashes( tv );
 
     for (i = row + 1; i < num_rows; i++)
     {
@@ -1880,6 +1987,7 @@ static UINT TABLE_find_matching_rows( struct tagMSIVIEW *view, UINT col,
 {
     MSITABLEVIEW *tv = (MSITABLEVIEW*)view;
     const MSICOLUMNHASHENTRY *entry;
+    const MSICOLUMNHASH *hash;
 
     TRACE("%p, %d, %u, %p\n", view, col, val, *handle);
 
@@ -1891,10 +1999,7 @@ static UINT TABLE_find_matching_rows( struct tagMSIVIEW *view, UINT col,
 
     if( !tv->columns[col-1].hash_table )
     {
-        UINT i;
-        UINT num_rows = tv->table->row_count;
-        MSICOLUMNHASHENTRY **hash_table;
-        MSICOLUMNHASHENTRY *new_entry;
+        UINT r;
 
         if( tv->columns[col-1].offset >= tv->row_size )
         {
@@ -1903,42 +2008,14 @@ static UINT TABLE_find_matching_rows( struct tagMSIVIEW *view, UINT col,
             return ERROR_FUNCTION_FAILED;
         }
 
-        /* allocate contiguous memory for the table and its entries so we
-         * don't have to do an expensive cleanup */
-        hash_table = msi_alloc(MSITABLE_HASH_TABLE_SIZE * sizeof(MSICOLUMNHASHENTRY*) +
-            num_rows * sizeof(MSICOLUMNHASHENTRY));
-        if (!hash_table)
-            return ERROR_OUTOFMEMORY;
-
-        memset(hash_table, 0, MSITABLE_HASH_TABLE_SIZE * sizeof(MSICOLUMNHASHENTRY*));
-        tv->columns[col-1].hash_table = hash_table;
-
-        new_entry = (MSICOLUMNHASHENTRY *)(hash_table + MSITABLE_HASH_TABLE_SIZE);
-
-        for (i = 0; i < num_rows; i++, new_entry++)
-        {
-            UINT row_value;
-
-            if (view->ops->fetch_int( view, i, col, &row_value ) != ERROR_SUCCESS)
-                continue;
-
-            new_entry->next = NULL;
-            new_entry->value = row_value;
-            new_entry->row = i;
-            if (hash_table[row_value % MSITABLE_HASH_TABLE_SIZE])
-            {
-                MSICOLUMNHASHENTRY *prev_entry = hash_table[row_value % MSITABLE_HASH_TABLE_SIZE];
-                while (prev_entry->next)
-                    prev_entry = prev_entry->next;
-                prev_entry->next = new_entry;
-            }
-            else
-                hash_table[row_value % MSITABLE_HASH_TABLE_SIZE] = new_entry;
-        }
+        r = build_column_hash( tv, col );
+        if (r != ERROR_SUCCESS)
+            return r;
     }
 
+    hash = tv->columns[col-1].hash_table;
     if( !*handle )
-        entry = tv->columns[col-1].hash_table[val % MSITABLE_HASH_TABLE_SIZE];
+        entry = hash->buckets[column_hash_bucket( hash, val )];
     else
         entry = (*handle)->next;
 
@@ -2497,11 +2574,37 @@ static UINT msi_row_matches( MSITABLEVIEW *tv, UINT row, const UINT *data, UINT
 
 static UINT msi_table_find_row( MSITABLEVIEW *tv, MSIRECORD *rec, UINT *row, UINT *column )
 {
-    UINT i, r = ERROR_FUNCTION_FAILED, *data;
+    UINT i, key, res, r = ERROR_FUNCTION_FAILED, *data;
+    MSIITERHANDLE handle = NULL;
 
     data = msi_record_to_row( tv, rec );
     if( !data )
         return r;
+
+    /* look up the candidate rows in the index of the first key column */
+    for( key = 0; key < tv->num_cols; key++ )
+        if( tv->columns[key].type & MSITYPE_KEY ) break;
+
+    if( key < tv->num_cols )
+    {
+        res = TABLE_find_matching_rows( &tv->view, key + 1, data[key], &i, &handle );
+        if( res == ERROR_SUCCESS || res == ERROR_NO_MORE_ITEMS )
+        {
+            while( res == ERROR_SUCCESS )
+            {
+                r = msi_row_matches( tv, i, data, column );
+                if( r == ERROR_SUCCESS )
+                {
+                    *row = i;
+                    break;
+                }
+                res = TABLE_find_matching_rows( &tv->view, key + 1, data[key], &i, &handle );
+            }
+            msi_free( data );
+            return r;
+        }
+    }
+
     for( i = 0; i < tv->table->row_count; i++ )
     {
         r = msi_row_matches( tv, i, data, column );
@@ -2179,6 +2179,97 @@ static void test_where(void)
     MsiViewClose(view);
     MsiCloseHandle(view);
 
+    /* equality lookups have to see changes made to the table */
+    query = "SELECT `Cabinet` FROM `Media` WHERE `DiskId` = 3";
+    r = do_query(hdb, query, &rec);
+    ok(r == ERROR_SUCCESS, "query failed: %d\n", r);
+    ok( check_record( rec, 1, "two.cab"), "wrong cabinet\n");
+    MsiCloseHandle( rec );
+
+    r = run_query( hdb, 0, "UPDATE `Media` SET `Cabinet` = 'three.cab' WHERE `DiskId` = 3" );
+    ok( r == ERROR_SUCCESS, "cannot update the Media table: %d\n", r );
+
+    query = "SELECT `DiskId` FROM `Media` WHERE `Cabinet` = 'two.cab'";
+    r = do_query(hdb, query, &rec);
+    ok( r == ERROR_NO_MORE_ITEMS, "query failed: %d\n", r );
+
+    query = "SELECT `DiskId` FROM `Media` WHERE `Cabinet` = 'three.cab'";
+    r = do_query(hdb, query, &rec);
+    ok(r == ERROR_SUCCESS, "query failed: %d\n", r);
+    r = MsiRecordGetInteger(rec, 1);
+    ok( r == 3, "expected 3, got %d\n", r );
+    MsiCloseHandle( rec );
+
+    r = run_query( hdb, 0, "INSERT INTO `Media` "
+            "( `DiskId`, `LastSequence`, `DiskPrompt`, `Cabinet`, `VolumeLabel`, `Source` ) "
+            "VALUES ( 4, 3, '', 'four.cab', '', '' )" );
+    ok( r == S_OK, "cannot add file to the Media table: %d\n", r );
+
+    r = run_query( hdb, 0, "DELETE FROM `Media` WHERE `DiskId` = 2" );
+    ok( r == ERROR_SUCCESS, "cannot delete from the Media table: %d\n", r );
+
+    query = "SELECT `DiskId` FROM `Media` WHERE `Cabinet` = 'one.cab'";
+    r = do_query(hdb, query, &rec);
+    ok( r == ERROR_NO_MORE_ITEMS, "query failed: %d\n", r );
+
+    rec = MsiCreateRecord(1);
+    MsiRecordSetInteger(rec, 1, 4);
+
+    query = "SELECT `Cabinet` FROM `Media` WHERE `DiskId` = ?";
+    r = MsiDatabaseOpenViewA(hdb, query, &view);
+    ok(r == ERROR_SUCCESS, "Expected ERROR_SUCCESS, got %d\n", r);
+    r = MsiViewExecute(view, rec);
+    ok(r == ERROR_SUCCESS, "Expected ERROR_SUCCESS, got %d\n", r);
+
+    MsiCloseHandle(rec);
+
+    r = MsiViewFetch(view, &rec);
+    ok(r == ERROR_SUCCESS, "Expected ERROR_SUCCESS, got %d\n", r);
+    ok( check_record( rec, 1, "four.cab"), "wrong cabinet\n");
+    MsiCloseHandle(rec);
+
+    r = MsiViewFetch(view, &rec);
+    ok(r == ERROR_NO_MORE_ITEMS, "Expected ERROR_NO_MORE_ITEMS, got %d\n", r);
+
+    MsiViewClose(view);
+    MsiCloseHandle(view);
+
+    /* rows found through an index are still returned in table order */
+    query = "SELECT `DiskId` FROM `Media` WHERE `Cabinet` = 'four.cab'";
+    r = do_query(hdb, query, &rec);
+    ok(r == ERROR_SUCCESS, "query failed: %d\n", r);
+    MsiCloseHandle( rec );
+
+    r = run_query( hdb, 0, "UPDATE `Media` SET `Cabinet` = 'four.cab' WHERE `DiskId` = 1" );
+    ok( r == ERROR_SUCCESS, "cannot update the Media table: %d\n", r );
+    r = run_query( hdb, 0, "UPDATE `Media` SET `Cabinet` = 'four.cab' WHERE `DiskId` = 3" );
+    ok( r == ERROR_SUCCESS, "cannot update the Media table: %d\n", r );
+    r = run_query( hdb, 0, "INSERT INTO `Media` "
+            "( `DiskId`, `LastSequence`, `DiskPrompt`, `Cabinet`, `VolumeLabel`, `Source` ) "
+            "VALUES ( 5, 4, '', 'four.cab', '', '' )" );
+    ok( r == S_OK, "cannot add file to the Media table: %d\n", r );
+
+    r = MsiDatabaseOpenViewA(hdb, query, &view);
+    ok(r == ERROR_SUCCESS, "Expected ERROR_SUCCESS, got %d\n", r);
+    r = MsiViewExecute(view, 0);
+    ok(r == ERROR_SUCCESS, "Expected ERROR_SUCCESS, got %d\n", r);
+
+    count = 0;
+    while (MsiViewFetch(view, &rec) == ERROR_SUCCESS)
+    {
+        static const int expected[] = { 1, 3, 4, 5 };
+
+        r = MsiRecordGetInteger(rec, 1);
+        if (count < ARRAY_SIZE(expected))
+            ok( r == expected[count], "%u: expected %d, got %d\n", count, expected[count], r );
+        MsiCloseHandle(rec);
+        count++;
+    }
+    ok( count == 4, "expected 4 rows, got %u\n", count );
+
+    MsiViewClose(view);
+    MsiCloseHandle(view);
+
     MsiCloseHandle( hdb );
     DeleteFileA(msifile);
 }
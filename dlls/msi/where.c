@@ -599,35 +599,207 @@ static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
     return ERROR_SUCCESS;
 }
 
+/* equality condition on a column of the table being iterated, used to find
+ * the candidate rows through the column index instead of checking every row */
+struct index_key
+{
+    BOOL found;
+    BOOL no_match;  /* no row can satisfy the condition */
+    UINT column;
+    UINT value;
+};
+
+static inline UINT column_value_offset( const struct expr *expr )
+{
+    if (expr->type == EXPR_COL_NUMBER) return 0x8000;
+    if (expr->type == EXPR_COL_NUMBER32) return 0x80000000;
+    return 0;
+}
+
+static inline BOOL is_table_column( const struct expr *expr, const JOINTABLE *table )
+{
+    return (expr->type == EXPR_COL_NUMBER || expr->type == EXPR_COL_NUMBER32 ||
+            expr->type == EXPR_COL_NUMBER_STRING) && expr->u.column.parsed.table == table;
+}
+
+static inline BOOL is_bound_column( const struct expr *expr, const UINT rows[] )
+{
+    return rows[expr->u.column.parsed.table->table_index] != INVALID_ROW_INDEX;
+}
+
+/* rec_index is the index of the last wildcard before the comparison */
+static void get_index_key( MSIWHEREVIEW *wv, const struct complex_expr *expr, JOINTABLE *table,
+                           const UINT rows[], MSIRECORD *record, UINT rec_index, struct index_key *key )
+{
+    const struct expr *column, *other;
+    const WCHAR *str = NULL;
+    UINT val = 0;
+
+    if (is_table_column( expr->left, table ))
+    {
+        column = expr->left;
+        other = expr->right;
+    }
+    else if (is_table_column( expr->right, table ))
+    {
+        column = expr->right;
+        other = expr->left;
+    }
+    else return;
+
+    switch (other->type)
+    {
+    case EXPR_UVAL:
+        if (column->type == EXPR_COL_NUMBER_STRING) return;
+        val = other->u.uval;
+        break;
+    case EXPR_SVAL:
+        if (column->type != EXPR_COL_NUMBER_STRING) return;
+        str = other->u.sval;
+        break;
+    case EXPR_WILDCARD:
+        if (column->type == EXPR_COL_NUMBER_STRING)
+            str = MSI_RecordGetString( record, rec_index + 1 );
+        else
+            val = MSI_RecordGetInteger( record, rec_index + 1 );
+        break;
+    case EXPR_COL_NUMBER:
+    case EXPR_COL_NUMBER32:
+    case EXPR_COL_NUMBER_STRING:
+        if (other->u.column.parsed.table == table || !is_bound_column( other, rows )) return;
+        if ((other->type == EXPR_COL_NUMBER_STRING) != (column->type == EXPR_COL_NUMBER_STRING)) return;
+        if (expr_fetch_value( &other->u.column, rows, &val ) != ERROR_SUCCESS) return;
+        /* null and empty strings compare equal */
+        if (other->type == EXPR_COL_NUMBER_STRING && !val) return;
+        val -= column_value_offset( other );
+        break;
+    default:
+        return;
+    }
+
+    if (column->type == EXPR_COL_NUMBER_STRING && other->type != EXPR_COL_NUMBER_STRING)
+    {
+        if (!str || !*str) return;
+        if (msi_string2id( wv->db->strings, str, -1, &val ) != ERROR_SUCCESS)
+            key->no_match = TRUE;
+    }
+
+    key->found = TRUE;
+    key->column = column->u.column.parsed.column;
+    key->value = val + column_value_offset( column );
+}
+
+/* walk the condition in evaluation order to keep track of the wildcards, and
+ * look for an equality to a known value that has to hold for the whole condition */
+static void find_index_key( MSIWHEREVIEW *wv, const struct expr *cond, BOOL conjunct, JOINTABLE *table,
+                            const UINT rows[], MSIRECORD *record, UINT *rec_index, struct index_key *key )
+{
+    UINT index = *rec_index;
+
+    switch (cond->type)
+    {
+    case EXPR_WILDCARD:
+        (*rec_index)++;
+        break;
+
+    case EXPR_COMPLEX:
+        conjunct = conjunct && cond->u.expr.op == OP_AND;
+        find_index_key( wv, cond->u.expr.left, conjunct, table, rows, record, rec_index, key );
+        find_index_key( wv, cond->u.expr.right, conjunct, table, rows, record, rec_index, key );
+        if (!key->found && conjunct && cond->u.expr.op == OP_EQ)
+            get_index_key( wv, &cond->u.expr, table, rows, record, index, key );
+        break;
+
+    case EXPR_STRCMP:
+        if (cond->u.expr.left->type == EXPR_WILDCARD)
+            (*rec_index)++;
+        else if (cond->u.expr.left->type == EXPR_COL_NUMBER_STRING &&
+                 cond->u.expr.left->u.column.parsed.table != table &&
+                 !is_bound_column( cond->u.expr.left, rows ))
+            break;  /* the right side is not evaluated */
+        if (cond->u.expr.right->type == EXPR_WILDCARD)
+            (*rec_index)++;
+        if (!key->found && conjunct && cond->u.expr.op == OP_EQ)
+            get_index_key( wv, &cond->u.expr, table, rows, record, index, key );
+        break;
+
+    default:
+        break;
+    }
+}
+
+static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
+                             UINT table_rows[] );
+
+static UINT check_row( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
+                       UINT table_rows[], BOOL *stop )
+{
+    UINT r;
+    INT val = 0;
+
+    *stop = TRUE;
+    wv->rec_index = 0;
+    r = WHERE_evaluate( wv, table_rows, wv->cond, &val, record );
+    if (r != ERROR_SUCCESS && r != ERROR_CONTINUE)
+        return r;
+    if (val)
+    {
+        if (*(tables + 1))
+        {
+            r = check_condition(wv, record, tables + 1, table_rows);
+            if (r != ERROR_SUCCESS)
+                return r;
+        }
+        else
+        {
+            if (r != ERROR_SUCCESS)
+                return r;
+            add_row (wv, table_rows);
+        }
+    }
+    *stop = FALSE;
+    return r;
+}
+
 static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
                              UINT table_rows[] )
 {
-    UINT r = ERROR_FUNCTION_FAILED;
-    INT val;
+    UINT r = ERROR_FUNCTION_FAILED, res = ERROR_NO_MORE_ITEMS, row, rec_index = 0;
+    struct index_key key = { FALSE };
+    MSIVIEW *view = (*tables)->view;
+    MSIITERHANDLE handle = NULL;
+    BOOL stop = FALSE;
+
+    if (wv->cond)
+        find_index_key( wv, wv->cond, TRUE, *tables, table_rows, record, &rec_index, &key );
 
-    for (table_rows[(*tables)->table_index] = 0;
-         table_rows[(*tables)->table_index] < (*tables)->row_count;
-         table_rows[(*tables)->table_index]++)
+    if (key.found && !key.no_match)
     {
-        val = 0;
-        wv->rec_index = 0;
-        r = WHERE_evaluate( wv, table_rows, wv->cond, &val, record );
-        if (r != ERROR_SUCCESS && r != ERROR_CONTINUE)
-            break;
-        if (val)
+        res = view->ops->find_matching_rows( view, key.column, key.value, &row, &handle );
+        /* fall back to checking every row if the index is not available */
+        if (res != ERROR_SUCCESS && res != ERROR_NO_MORE_ITEMS)
+            key.found = FALSE;
+    }
+
+    if (key.no_match)
+        r = ERROR_SUCCESS;
+    else if (key.found)
+    {
+        r = ERROR_SUCCESS;
+        while (!stop && res == ERROR_SUCCESS)
         {
-            if (*(tables + 1))
-            {
-                r = check_condition(wv, record, tables + 1, table_rows);
-                if (r != ERROR_SUCCESS)
-                    break;
-            }
-            else
-            {
-                if (r != ERROR_SUCCESS)
-                    break;
-                add_row (wv, table_rows);
-            }
+            table_rows[(*tables)->table_index] = row;
+            r = check_row( wv, record, tables, table_rows, &stop );
+            if (!stop)
+                res = view->ops->find_matching_rows( view, key.column, key.value, &row, &handle );
+        }
+    }
+    else
+    {
+        for (row = 0; !stop && row < (*tables)->row_count; row++)
+        {
+            table_rows[(*tables)->table_index] = row;
+            r = check_row( wv, record, tables, table_rows, &stop );
         }
     }
     table_rows[(*tables)->table_index] = INVALID_ROW_INDEX;
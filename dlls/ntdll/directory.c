@@ -192,6 +192,41 @@ struct dir_data
     struct dir_data_buffer *buffer;  /* head of data buffers list */
 };
 
+/* cached case-insensitive name lookup table for a directory */
+struct dir_lookup_name
+{
+    ULONG         hash;         /* hash of the lower-case name */
+    int           next;         /* next name in the same hash bucket, or -1 */
+    unsigned int  nameW;        /* offset of the lower-case name in the Unicode buffer */
+    unsigned int  unix_name;    /* offset of the Unix name in the Unix buffer */
+    USHORT        len;          /* length of the lower-case name in chars */
+    BOOLEAN       is_short;     /* whether this is a generated short name */
+};
+
+struct dir_lookup_cache
+{
+    struct list             entry;       /* entry in the cache list, most recently used first */
+    struct file_identity    id;          /* directory file identity */
+    time_t                  mtime;       /* directory modification time when the cache was built */
+    unsigned long           mtime_nsec;
+    unsigned int            count;       /* count of names in the table */
+    unsigned int            size;        /* size of the names array */
+    unsigned int            bucket_count; /* size of the hash buckets array */
+    int                    *buckets;     /* hash buckets, index of the first name or -1 */
+    struct dir_lookup_name *names;       /* names array */
+    WCHAR                  *bufferW;     /* buffer for lower-case Unicode names */
+    unsigned int            sizeW;       /* size of the Unicode buffer in chars */
+    unsigned int            posW;        /* current position in the Unicode buffer */
+    char                   *buffer;      /* buffer for Unix names */
+    unsigned int            size_unix;   /* size of the Unix buffer */
+    unsigned int            pos_unix;    /* current position in the Unix buffer */
+};
+
+#define MAX_DIR_LOOKUP_CACHES 32  /* max number of directories in the lookup cache */
+
+static struct list dir_lookup_caches = LIST_INIT( dir_lookup_caches );
+static unsigned int dir_lookup_cache_count;
+
 static const unsigned int dir_data_buffer_initial_size = 4096;
 static const unsigned int dir_data_cache_initial_size  = 256;
 static const unsigned int dir_data_names_initial_size  = 64;
@@ -2024,6 +2059,256 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event,
 }
 
 
+/***********************************************************************
+ *           hash_dir_lookup_name
+ *
+ * Convert a name to lower-case and compute its hash for the directory lookup cache.
+ */
+static ULONG hash_dir_lookup_name( const WCHAR *name, int len, WCHAR *lower )
+{
+    ULONG hash = 0;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        lower[i] = tolowerW( name[i] );
+        hash = hash * 31 + lower[i];
+    }
+    return hash;
+}
+
+static void free_dir_lookup_cache( struct dir_lookup_cache *cache )
+{
+    RtlFreeHeap( GetProcessHeap(), 0, cache->buckets );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->bufferW );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->buffer );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+/* grow a buffer of the lookup cache to make room for 'count' more elements */
+static BOOL grow_dir_lookup_buffer( void **buffer, unsigned int *size, unsigned int pos,
+                                    unsigned int count, unsigned int elem_size, unsigned int initial )
+{
+    unsigned int new_size = *size ? *size : initial;
+    void *new_buffer;
+
+    if (pos + count <= *size) return TRUE;
+    while (pos + count > new_size) new_size *= 2;
+    if (*buffer) new_buffer = RtlReAllocateHeap( GetProcessHeap(), 0, *buffer, new_size * elem_size );
+    else new_buffer = RtlAllocateHeap( GetProcessHeap(), 0, new_size * elem_size );
+    if (!new_buffer) return FALSE;
+    *buffer = new_buffer;
+    *size = new_size;
+    return TRUE;
+}
+
+/* add a name to the directory lookup cache */
+static BOOL add_dir_lookup_name( struct dir_lookup_cache *cache, const WCHAR *name, int len,
+                                 unsigned int unix_name, BOOLEAN is_short )
+{
+    struct dir_lookup_name *entry;
+
+    if (!grow_dir_lookup_buffer( (void **)&cache->names, &cache->size, cache->count, 1,
+                                 sizeof(*cache->names), 64 ))
+        return FALSE;
+    if (!grow_dir_lookup_buffer( (void **)&cache->bufferW, &cache->sizeW, cache->posW, len,
+                                 sizeof(WCHAR), 4096 ))
+        return FALSE;
+
+    entry = &cache->names[cache->count++];
+    entry->hash      = hash_dir_lookup_name( name, len, cache->bufferW + cache->posW );
+    entry->nameW     = cache->posW;
+    entry->unix_name = unix_name;
+    entry->len       = len;
+    entry->is_short  = is_short;
+    cache->posW += len;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           create_dir_lookup_cache
+ *
+ * Read a directory and build its case-insensitive lookup table.
+ */
+static struct dir_lookup_cache *create_dir_lookup_cache( const char *unix_name, const struct stat *st )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_lookup_cache *cache;
+    UNICODE_STRING str;
+    BOOLEAN spaces;
+    struct dirent *de;
+    unsigned int i, len;
+    DIR *dir;
+    int ret;
+
+    if (!(dir = opendir( unix_name ))) return NULL;
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) )))
+    {
+        closedir( dir );
+        return NULL;
+    }
+    cache->id.dev = st->st_dev;
+    cache->id.ino = st->st_ino;
+    cache->mtime  = st->st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    cache->mtime_nsec = st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    cache->mtime_nsec = st->st_mtimespec.tv_nsec;
+#endif
+
+    str.Buffer = buffer;
+    str.MaximumLength = sizeof(buffer);
+    while ((de = readdir( dir )))
+    {
+        ret = ntdll_umbstowcs( 0, de->d_name, strlen(de->d_name), buffer, MAX_DIR_ENTRY_LEN );
+        if (ret <= 0) continue;
+
+        len = strlen( de->d_name ) + 1;
+        if (!grow_dir_lookup_buffer( (void **)&cache->buffer, &cache->size_unix, cache->pos_unix, len,
+                                     sizeof(char), 4096 ))
+            goto error;
+        memcpy( cache->buffer + cache->pos_unix, de->d_name, len );
+
+        if (!add_dir_lookup_name( cache, buffer, ret, cache->pos_unix, FALSE )) goto error;
+
+        str.Length = ret * sizeof(WCHAR);
+        if (!RtlIsNameLegalDOS8Dot3( &str, NULL, &spaces ) || spaces)
+        {
+            WCHAR short_nameW[12];
+            ret = hash_short_file_name( &str, short_nameW );
+            if (!add_dir_lookup_name( cache, short_nameW, ret, cache->pos_unix, TRUE ))
+                goto error;
+        }
+        cache->pos_unix += len;
+    }
+    closedir( dir );
+
+    /* now build the hash table */
+    cache->bucket_count = 16;
+    while (cache->bucket_count < cache->count) cache->bucket_count *= 2;
+    if (!(cache->buckets = RtlAllocateHeap( GetProcessHeap(), 0,
+                                            cache->bucket_count * sizeof(*cache->buckets) )))
+    {
+        free_dir_lookup_cache( cache );
+        return NULL;
+    }
+    for (i = 0; i < cache->bucket_count; i++) cache->buckets[i] = -1;
+    /* insert in reverse order so that names are found in readdir order */
+    for (i = cache->count; i > 0; i--)
+    {
+        struct dir_lookup_name *entry = &cache->names[i - 1];
+        ULONG bucket = entry->hash & (cache->bucket_count - 1);
+        entry->next = cache->buckets[bucket];
+        cache->buckets[bucket] = i - 1;
+    }
+    TRACE( "%s: cached %u names\n", debugstr_a(unix_name), cache->count );
+    return cache;
+
+error:
+    closedir( dir );
+    free_dir_lookup_cache( cache );
+    return NULL;
+}
+
+/***********************************************************************
+ *           get_dir_lookup_cache
+ *
+ * Retrieve the lookup cache for a directory, creating it if needed.
+ * Must be called with dir_section held.
+ */
+static struct dir_lookup_cache *get_dir_lookup_cache( const char *unix_name )
+{
+    struct dir_lookup_cache *cache;
+    struct stat st;
+    unsigned long nsec = 0;
+
+    if (stat( unix_name, &st ) == -1) return NULL;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    nsec = st.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    nsec = st.st_mtimespec.tv_nsec;
+#endif
+
+    LIST_FOR_EACH_ENTRY( cache, &dir_lookup_caches, struct dir_lookup_cache, entry )
+    {
+        if (!is_same_file( &cache->id, &st )) continue;
+        list_remove( &cache->entry );
+        if (cache->mtime == st.st_mtime && cache->mtime_nsec == nsec)
+        {
+            list_add_head( &dir_lookup_caches, &cache->entry );
+            return cache;
+        }
+        /* directory has changed */
+        free_dir_lookup_cache( cache );
+        dir_lookup_cache_count--;
+        break;
+    }
+
+    /* changes made in the same time slice would not be visible in the modification time,
+     * so only cache directories that haven't changed for a while; leave some margin for
+     * remote file systems. Others are scanned directly, which stops at the first match. */
+    if (st.st_mtime >= time( NULL ) - 2) return NULL;
+
+    if (!(cache = create_dir_lookup_cache( unix_name, &st ))) return NULL;
+
+    if (dir_lookup_cache_count == MAX_DIR_LOOKUP_CACHES)
+    {
+        struct dir_lookup_cache *last = LIST_ENTRY( list_tail( &dir_lookup_caches ),
+                                                    struct dir_lookup_cache, entry );
+        list_remove( &last->entry );
+        free_dir_lookup_cache( last );
+        dir_lookup_cache_count--;
+    }
+    list_add_head( &dir_lookup_caches, &cache->entry );
+    dir_lookup_cache_count++;
+    return cache;
+}
+
+/***********************************************************************
+ *           find_file_in_dir_cache
+ *
+ * Case-insensitive search of a file through the directory lookup cache.
+ * unix_name contains the directory name, the file found is appended at pos.
+ * Returns 1 if found, 0 if not found, -1 if the cache can't be used.
+ */
+static int find_file_in_dir_cache( char *unix_name, int pos, const WCHAR *name, int length,
+                                   BOOLEAN check_short )
+{
+    WCHAR lower[MAX_DIR_ENTRY_LEN];
+    struct dir_lookup_cache *cache;
+    const struct dir_lookup_name *entry = NULL, *found = NULL;
+    ULONG hash;
+    int i, ret = -1;
+
+    if (length > MAX_DIR_ENTRY_LEN) return -1;
+    hash = hash_dir_lookup_name( name, length, lower );
+
+    RtlEnterCriticalSection( &dir_section );
+    if ((cache = get_dir_lookup_cache( unix_name )))
+    {
+        for (i = cache->buckets[hash & (cache->bucket_count - 1)]; i != -1; i = entry->next)
+        {
+            entry = &cache->names[i];
+            if (entry->hash != hash || entry->len != length) continue;
+            if (entry->is_short && !check_short) continue;
+            if (memcmp( cache->bufferW + entry->nameW, lower, length * sizeof(WCHAR) )) continue;
+            found = entry;  /* buckets are in readdir order, so this is the first match */
+            break;
+        }
+        if (found)
+        {
+            unix_name[pos - 1] = '/';
+            strcpy( unix_name + pos, cache->buffer + found->unix_name );
+            ret = 1;
+        }
+        else ret = 0;
+    }
+    RtlLeaveCriticalSection( &dir_section );
+    return ret;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2134,6 +2419,13 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    switch (find_file_in_dir_cache( unix_name, pos, name, length, is_name_8_dot_3 ))
+    {
+    case 1: goto success;
+    case 0: goto not_found;
+    default: break;  /* fall through to normal handling */
+    }
+
     if (!(dir = opendir( unix_name )))
     {
         if (errno == ENOENT) return STATUS_OBJECT_PATH_NOT_FOUND;
@@ -57,6 +57,9 @@
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
 #ifdef MAJOR_IN_MKDEV
 # include <sys/mkdev.h>
 #elif defined(MAJOR_IN_SYSMACROS)
@@ -227,6 +230,7 @@ static NTSTATUS FILE_CreateFile( PHANDLE handle, ACCESS_MASK access, POBJECT_ATT
         OBJECT_ATTRIBUTES unix_attr = *attr;
         data_size_t len;
         struct object_attributes *objattr;
+        sigset_t sigset;
 
         unix_attr.ObjectName = &empty_string;  /* we send the unix name instead */
         if ((io->u.Status = alloc_object_attributes( &unix_attr, &objattr, &len )))
@@ -235,6 +239,8 @@ static NTSTATUS FILE_CreateFile( PHANDLE handle, ACCESS_MASK access, POBJECT_ATT
             return io->u.Status;
         }
 
+        /* the reply may come with the unix fd, which goes straight to the fd cache */
+        server_enter_fd_cache_section( &sigset );
         SERVER_START_REQ( create_file )
         {
             req->access     = access;
@@ -246,8 +252,11 @@ static NTSTATUS FILE_CreateFile( PHANDLE handle, ACCESS_MASK access, POBJECT_ATT
             wine_server_add_data( req, unix_name.Buffer, unix_name.Length );
             io->u.Status = wine_server_call( req );
             *handle = wine_server_ptr_handle( reply->handle );
+            if (!io->u.Status)
+                server_cache_prefetched_fd( *handle, reply->type, reply->access, reply->options );
         }
         SERVER_END_REQ;
+        server_leave_fd_cache_section( &sigset );
         RtlFreeHeap( GetProcessHeap(), 0, objattr );
         RtlFreeAnsiString( &unix_name );
     }
@@ -803,6 +812,151 @@ static NTSTATUS register_async_file_read( HANDLE handle, HANDLE event,
     return status;
 }
 
+#if defined(HAVE_PREADV2) && defined(RWF_NOWAIT)
+
+struct async_file_read
+{
+    struct async_fileio io;
+    LONG                refcount; /* held by the worker and by the server async */
+    NTSTATUS            status;   /* result of the read, set by the worker */
+    ULONG               total;
+    void               *buffer;   /* caller's buffer */
+    char               *data;     /* private buffer the worker reads into */
+    ULONG               length;
+    off_t               offset;
+    int                 fd;
+};
+
+static void release_async_file_read( struct async_file_read *fileio )
+{
+    if (interlocked_xchg_add( &fileio->refcount, -1 ) > 1) return;
+    if (fileio->fd != -1) close( fileio->fd );
+    RtlFreeHeap( GetProcessHeap(), 0, fileio->data );
+    release_fileio( &fileio->io );
+}
+
+/* async callback for offloaded reads, the server calls it once the worker
+ * woke it up or when the read got cancelled or the handle closed */
+static NTSTATUS async_file_read_service( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS status )
+{
+    struct async_file_read *fileio = user;
+    ULONG total = 0;
+
+    if (status == STATUS_ALERTED)
+    {
+        status = fileio->status;
+        total = fileio->total;
+        memcpy( fileio->buffer, fileio->data, total );
+    }
+    iosb->u.Status = status;
+    iosb->Information = total;
+    release_async_file_read( fileio );
+    return status;
+}
+
+/* worker thread callback for regular file reads that had to go to the disk */
+static DWORD CALLBACK async_file_read_proc( void *arg )
+{
+    struct async_file_read *fileio = arg;
+    ssize_t result;
+
+    while ((result = pread( fileio->fd, fileio->data, fileio->length, fileio->offset )) == -1 &&
+           errno == EINTR);
+    if (result == -1) fileio->status = FILE_GetNtStatus();
+    else
+    {
+        fileio->total = result;
+        fileio->status = result ? STATUS_SUCCESS : STATUS_END_OF_FILE;
+    }
+
+    /* fails if the async has been cancelled in the meantime */
+    SERVER_START_REQ( wake_client_async )
+    {
+        req->user = wine_server_client_ptr( fileio );
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+
+    release_async_file_read( fileio );
+    return 0;
+}
+
+/***********************************************************************
+ *           try_async_file_read
+ *
+ * Read from a regular file opened for overlapped I/O without blocking the
+ * calling thread. Data that is already in the page cache is returned
+ * directly, otherwise the read is queued as a server async and handed to
+ * the thread pool, and STATUS_PENDING is returned. Returns
+ * STATUS_NOT_SUPPORTED when the caller should fall back to a plain
+ * synchronous read.
+ *
+ * The worker reads into a private buffer that is only copied to the
+ * caller's buffer when the server completes the async, so a read that got
+ * cancelled or whose handle got closed never touches the caller's memory.
+ */
+static NTSTATUS try_async_file_read( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
+                                     void *apc_user, IO_STATUS_BLOCK *iosb, void *buffer,
+                                     ULONG length, off_t offset, ULONG *total )
+{
+    struct async_file_read *fileio;
+    struct iovec iov;
+    ssize_t result;
+    NTSTATUS status;
+
+    iov.iov_base = buffer;
+    iov.iov_len  = length;
+    while ((result = preadv2( fd, &iov, 1, offset, RWF_NOWAIT )) == -1 && errno == EINTR);
+
+    /* short reads may be partially cached data or the end of the file, let the caller sort it out */
+    if (result == length)
+    {
+        *total = result;
+        return STATUS_SUCCESS;
+    }
+    if (result != -1 || errno != EAGAIN) return STATUS_NOT_SUPPORTED;
+
+    if (!(fileio = (struct async_file_read *)alloc_fileio( sizeof(*fileio), async_file_read_service, handle )))
+        return STATUS_NOT_SUPPORTED;
+    fileio->refcount = 2;
+    fileio->status   = STATUS_SUCCESS;
+    fileio->total    = 0;
+    fileio->buffer   = buffer;
+    fileio->length   = length;
+    fileio->offset   = offset;
+    if (!(fileio->data = RtlAllocateHeap( GetProcessHeap(), 0, length )))
+    {
+        release_fileio( &fileio->io );
+        return STATUS_NOT_SUPPORTED;
+    }
+    if ((fileio->fd = dup( fd )) == -1)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, fileio->data );
+        release_fileio( &fileio->io );
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    SERVER_START_REQ( register_client_async )
+    {
+        req->async  = server_async( handle, &fileio->io, event, apc, apc_user, iosb );
+        req->access = FILE_READ_DATA;
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+
+    if (status != STATUS_PENDING)
+    {
+        fileio->refcount = 1;
+        release_async_file_read( fileio );
+        return STATUS_NOT_SUPPORTED;
+    }
+    /* the async is queued already, if there's no worker do the read right away */
+    if (RtlQueueWorkItem( async_file_read_proc, fileio, WT_EXECUTEDEFAULT )) async_file_read_proc( fileio );
+    return STATUS_PENDING;
+}
+
+#endif  /* HAVE_PREADV2 && RWF_NOWAIT */
+
 
 /******************************************************************************
  *  NtReadFile					[NTDLL.@]
@@ -866,7 +1020,15 @@ NTSTATUS WINAPI NtReadFile(HANDLE hFile, HANDLE hEvent,
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
-            /* async I/O doesn't make sense on regular files */
+#if defined(HAVE_PREADV2) && defined(RWF_NOWAIT)
+            if (async_read && length)
+            {
+                status = try_async_file_read( hFile, unix_handle, hEvent, apc, apc_user, io_status,
+                                              buffer, length, offset->QuadPart, &total );
+                if (status == STATUS_SUCCESS) goto done;
+                if (status == STATUS_PENDING) goto err;
+            }
+#endif
             while ((result = virtual_locked_pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
                 if (errno != EINTR)
@@ -1016,7 +1178,7 @@ err:
         if (status != STATUS_PENDING && hEvent) NtResetEvent( hEvent, NULL );
     }
 
-    if (send_completion) NTDLL_AddCompletion( hFile, cvalue, status, total );
+    if (send_completion) NTDLL_AddCompletion( hFile, cvalue, status, total, FALSE );
 
     return status;
 }
@@ -1091,7 +1253,8 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
     if (event) NtSetEvent( event, NULL );
     if (apc) NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)apc,
                                (ULONG_PTR)apc_user, (ULONG_PTR)io_status, 0 );
-    if (send_completion) NTDLL_AddCompletion( file, cvalue, status, total );
+    /* the caller is told the I/O is pending, so the packet is always queued */
+    if (send_completion) NTDLL_AddCompletion( file, cvalue, status, total, TRUE );
 
     return STATUS_PENDING;
 
@@ -1410,7 +1573,7 @@ err:
         if (status != STATUS_PENDING && hEvent) NtResetEvent( hEvent, NULL );
     }
 
-    if (send_completion) NTDLL_AddCompletion( hFile, cvalue, status, total );
+    if (send_completion) NTDLL_AddCompletion( hFile, cvalue, status, total, FALSE );
 
     return status;
 }
@@ -1502,7 +1665,7 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         if (status != STATUS_PENDING && event) NtResetEvent( event, NULL );
     }
 
-    if (send_completion) NTDLL_AddCompletion( file, cvalue, status, total );
+    if (send_completion) NTDLL_AddCompletion( file, cvalue, status, total, FALSE );
 
     return status;
 }
@@ -2728,6 +2891,24 @@ NTSTATUS WINAPI NtSetInformationFile(HANDLE handle, PIO_STATUS_BLOCK io,
             io->u.Status = STATUS_INVALID_PARAMETER_3;
         break;
 
+    case FileIoCompletionNotificationInformation:
+        if (len >= sizeof(FILE_IO_COMPLETION_NOTIFICATION_INFORMATION))
+        {
+            FILE_IO_COMPLETION_NOTIFICATION_INFORMATION *info = ptr;
+
+            SERVER_START_REQ( set_fd_completion_mode )
+            {
+                req->handle   = wine_server_obj_handle( handle );
+                req->flags    = info->Flags;
+                io->u.Status  = wine_server_call( req );
+            }
+            SERVER_END_REQ;
+            if (!io->u.Status && (info->Flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS))
+                server_set_fd_skip_completion( handle );
+        } else
+            io->u.Status = STATUS_INFO_LENGTH_MISMATCH;
+        break;
+
     case FileAllInformation:
         io->u.Status = STATUS_INVALID_INFO_CLASS;
         break;
@@ -83,6 +83,7 @@ typedef struct
 /* Value for arena 'magic' field */
 #define ARENA_INUSE_MAGIC      0x455355
 #define ARENA_PENDING_MAGIC    0xbedead
+#define ARENA_LFH_MAGIC        0x48464c   /* free block cached in the LFH front end */
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
 
@@ -96,6 +97,7 @@ typedef struct
 #define ARENA_OFFSET           (ALIGNMENT - sizeof(ARENA_INUSE))
 
 C_ASSERT( sizeof(ARENA_LARGE) % LARGE_ALIGNMENT == 0 );
+C_ASSERT( sizeof(ARENA_INUSE) == sizeof(__int64) );
 
 #define ROUND_SIZE(size)       ((((size) + ALIGNMENT - 1) & ~(ALIGNMENT-1)) + ARENA_OFFSET)
 
@@ -126,6 +128,12 @@ static const SIZE_T HEAP_freeListSizes[] =
 };
 #define HEAP_NB_FREE_LISTS (ARRAY_SIZE( HEAP_freeListSizes ) + HEAP_NB_SMALL_FREE_LISTS)
 
+/* The low-fragmentation front end keeps a lock-free list of free blocks for every
+ * block size from HEAP_MIN_DATA_SIZE up to HEAP_LFH_MAX_SIZE */
+#define HEAP_NB_LFH_LISTS     64
+#define HEAP_LFH_MAX_SIZE     (HEAP_MIN_DATA_SIZE + (HEAP_NB_LFH_LISTS - 1) * ALIGNMENT)
+#define HEAP_LFH_MAX_DEPTH    256  /* max number of blocks cached in a given list */
+
 typedef union
 {
     ARENA_FREE  arena;
@@ -164,6 +172,8 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    SLIST_HEADER    *lfh;           /* Low-fragmentation front end lists, if enabled */
+    RTL_SRWLOCK      subheap_lock;  /* Lock for the sub-heap list, for the front end */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -296,7 +306,8 @@ static void subheap_notify_free_all(SUBHEAP const *subheap)
         {
             ARENA_INUSE const *pArena = (ARENA_INUSE const *)ptr;
             if (pArena->magic == ARENA_INUSE_MAGIC) notify_free(pArena + 1);
-            else if (pArena->magic != ARENA_PENDING_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
+            else if (pArena->magic != ARENA_PENDING_MAGIC && pArena->magic != ARENA_LFH_MAGIC)
+                ERR("bad inuse_magic @%p\n", pArena);
             ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
         }
     }
@@ -679,7 +690,9 @@ static void HEAP_MakeInUseBlockFree( SUBHEAP *subheap, ARENA_INUSE *pArena )
         /* Remove the free block from the list */
         list_remove( &pFree->entry );
         /* Remove the subheap from the list */
+        RtlAcquireSRWLockExclusive( &subheap->heap->subheap_lock );
         list_remove( &subheap->entry );
+        RtlReleaseSRWLockExclusive( &subheap->heap->subheap_lock );
         /* Free the memory */
         subheap->magic = 0;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -915,7 +928,9 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         subheap->commitSize = commitSize;
         subheap->magic      = SUBHEAP_MAGIC;
         subheap->headerSize = ROUND_SIZE( sizeof(SUBHEAP) );
+        RtlAcquireSRWLockExclusive( &heap->subheap_lock );
         list_add_head( &heap->subheap_list, &subheap->entry );
+        RtlReleaseSRWLockExclusive( &heap->subheap_lock );
     }
     else
     {
@@ -925,6 +940,8 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         heap->flags         = flags;
         heap->magic         = HEAP_MAGIC;
         heap->grow_size     = max( HEAP_DEF_SIZE, totalSize );
+        heap->lfh           = NULL;
+        RtlInitializeSRWLock( &heap->subheap_lock );
         list_init( &heap->subheap_list );
         list_init( &heap->large_list );
 
@@ -1214,7 +1231,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
     }
 
     /* Check magic number */
-    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC)
+    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC &&
+        pArena->magic != ARENA_LFH_MAGIC)
     {
         if (quiet == NOISY) {
             ERR("Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, pArena->magic, pArena );
@@ -1425,11 +1443,13 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
 
     if ((const char *)arena < (char *)subheap->base + subheap->headerSize)
         WARN( "Heap %p: pointer %p is inside subheap %p header\n", subheap->heap, arena + 1, subheap );
+    else if ((const char *)(arena + 1) > (char *)subheap->base + subheap->commitSize)
+        WARN( "Heap %p: pointer %p is outside the committed part of subheap %p\n", subheap->heap, arena + 1, subheap );
     else if (subheap->heap->flags & HEAP_VALIDATE)  /* do the full validation */
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_LFH_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1447,6 +1467,111 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
 }
 
 
+/* locate the front end list for a given block size, or -1 if it is not handled by the front end */
+static inline int get_lfh_index( SIZE_T size )
+{
+    if (size < HEAP_MIN_DATA_SIZE || size > HEAP_LFH_MAX_SIZE) return -1;
+    if ((size - HEAP_MIN_DATA_SIZE) % ALIGNMENT) return -1;
+    return (size - HEAP_MIN_DATA_SIZE) / ALIGNMENT;
+}
+
+/***********************************************************************
+ *           lfh_alloc
+ *
+ * Allocate a block from the low-fragmentation front end, without taking the heap lock.
+ */
+static void *lfh_alloc( HEAP *heap, DWORD flags, SIZE_T size, SIZE_T rounded_size )
+{
+    int index = get_lfh_index( rounded_size );
+    ARENA_INUSE *arena;
+    SLIST_ENTRY *entry;
+
+    if (index == -1) return NULL;
+    if (!(entry = RtlInterlockedPopEntrySList( &heap->lfh[index] ))) return NULL;
+
+    arena = (ARENA_INUSE *)entry - 1;
+    arena->magic = ARENA_INUSE_MAGIC;
+    arena->unused_bytes = (arena->size & ARENA_SIZE_MASK) - size;
+
+    notify_alloc( arena + 1, size, flags & HEAP_ZERO_MEMORY );
+    initialize_block( arena + 1, size, arena->unused_bytes, flags );
+    return arena + 1;
+}
+
+/***********************************************************************
+ *           lfh_free
+ *
+ * Return a block to the low-fragmentation front end, without taking the heap lock.
+ * Returns FALSE if the block has to be freed the normal way.
+ */
+static BOOL lfh_free( HEAP *heap, ARENA_INUSE *arena )
+{
+    ARENA_INUSE old, new;
+    SUBHEAP *subheap;
+    int index = -1;
+    BOOL ret = FALSE;
+
+    if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET) return FALSE;
+
+    /* the sub-heap list can change under us, but sub-heaps containing in-use blocks can't go away */
+    RtlAcquireSRWLockShared( &heap->subheap_lock );
+    if ((subheap = HEAP_FindSubHeap( heap, arena )) &&
+        (const char *)arena >= (const char *)subheap->base + subheap->headerSize &&
+        (const char *)(arena + 1) <= (const char *)subheap->base + subheap->commitSize)
+    {
+        old = *arena;
+        if (old.magic == ARENA_INUSE_MAGIC && !(old.size & ARENA_FLAG_FREE) &&
+            (old.size & ARENA_SIZE_MASK) <= (const char *)subheap->base + subheap->commitSize - (const char *)(arena + 1) &&
+            (index = get_lfh_index( old.size & ARENA_SIZE_MASK )) != -1 &&
+            RtlQueryDepthSList( &heap->lfh[index] ) < HEAP_LFH_MAX_DEPTH)
+        {
+            /* the size flags can be modified by the heap owner, and another thread
+             * could be freeing the same block, so switch the magic atomically */
+            new = old;
+            new.magic = ARENA_LFH_MAGIC;
+            ret = (interlocked_cmpxchg64( (__int64 *)arena, *(__int64 *)&new, *(__int64 *)&old ) ==
+                   *(__int64 *)&old);
+        }
+    }
+    RtlReleaseSRWLockShared( &heap->subheap_lock );
+
+    if (ret) RtlInterlockedPushEntrySList( &heap->lfh[index], (SLIST_ENTRY *)(arena + 1) );
+    return ret;
+}
+
+/***********************************************************************
+ *           enable_lfh
+ *
+ * Enable the low-fragmentation front end for a heap.
+ */
+static NTSTATUS enable_lfh( HEAP *heap )
+{
+    SIZE_T size = HEAP_NB_LFH_LISTS * sizeof(SLIST_HEADER);
+    void *ptr = NULL;
+    NTSTATUS status;
+
+    if (heap->lfh) return STATUS_SUCCESS;
+
+    /* the front end doesn't support the debugging features */
+    if ((heap->flags & (HEAP_NO_SERIALIZE | HEAP_TAIL_CHECKING_ENABLED |
+                        HEAP_FREE_CHECKING_ENABLED | HEAP_VALIDATE)) || RUNNING_ON_VALGRIND)
+        return STATUS_UNSUCCESSFUL;
+
+    if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 0, &size,
+                                           MEM_COMMIT, PAGE_READWRITE )))
+        return status;
+
+    /* the lists are already initialized since the memory is zeroed */
+    if (interlocked_cmpxchg_ptr( (void **)&heap->lfh, ptr, NULL ))
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &ptr, &size, MEM_RELEASE );
+    }
+    TRACE( "enabled low-fragmentation front end for heap %p\n", heap );
+    return STATUS_SUCCESS;
+}
+
+
 /***********************************************************************
  *           heap_set_debug_flags
  */
@@ -1638,6 +1763,12 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
         addr = heapPtr->pending_free;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    if (heapPtr->lfh)
+    {
+        size = 0;
+        addr = heapPtr->lfh;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     size = 0;
     addr = heapPtr->subheap.base;
     NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -1683,6 +1814,16 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh)
+    {
+        void *ret = lfh_alloc( heapPtr, flags, size, rounded_size );
+        if (ret)
+        {
+            TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
+            return ret;
+        }
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1766,6 +1907,14 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+
+    if (heapPtr->lfh && lfh_free( heapPtr, (ARENA_INUSE *)ptr - 1 ))
+    {
+        notify_free( ptr );
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
@@ -2133,7 +2282,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         }
 
         if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC ||
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_LFH_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2181,7 +2331,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         entry->lpData = pArena + 1;
         entry->cbData = pArena->size & ARENA_SIZE_MASK;
         entry->cbOverhead = sizeof(ARENA_INUSE);
-        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC) ?
+        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC || pArena->magic == ARENA_LFH_MAGIC) ?
                         PROCESS_HEAP_UNCOMMITTED_RANGE : PROCESS_HEAP_ENTRY_BUSY;
         /* FIXME: can't handle PROCESS_HEAP_ENTRY_MOVEABLE
         and PROCESS_HEAP_ENTRY_DDESHARE yet */
@@ -2246,6 +2396,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2254,7 +2406,9 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        heapPtr = HEAP_GetPtr( heap );
+        /* low-fragmentation or standard heap */
+        *(ULONG *)info = (heapPtr && heapPtr->lfh) ? 2 : 0;
         return STATUS_SUCCESS;
 
     default:
@@ -2268,6 +2422,24 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        TRACE("%p compatibility %u\n", heap, *(ULONG *)info);
+        if (*(ULONG *)info != 2)
+        {
+            FIXME("%p unsupported compatibility mode %u\n", heap, *(ULONG *)info);
+            return STATUS_UNSUCCESSFUL;
+        }
+        return enable_lfh( heapPtr );
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
@@ -50,6 +50,7 @@ WINE_DECLARE_DEBUG_CHANNEL(relay);
 WINE_DECLARE_DEBUG_CHANNEL(snoop);
 WINE_DECLARE_DEBUG_CHANNEL(loaddll);
 WINE_DECLARE_DEBUG_CHANNEL(imports);
+WINE_DECLARE_DEBUG_CHANNEL(loader_perf);
 
 #ifdef _WIN64
 #define DEFAULT_SECURITY_COOKIE_64  (((ULONGLONG)0x00002b99 << 32) | 0x2ddfa232)
@@ -102,8 +103,50 @@ typedef struct _wine_modref
     int                   alloc_deps;
     int                   nDeps;
     struct _wine_modref **deps;
+    DWORD                *export_hash;      /* hash table of exported names, built on first use */
+    DWORD                 export_hash_mask; /* size of the hash table minus one */
 } WINE_MODREF;
 
+/* min. number of exported names for using a hash table */
+#define MIN_EXPORT_HASH_NAMES 32
+
+/* loader timings, reported on the loader_perf channel */
+static struct
+{
+    LONGLONG imports;       /* time spent resolving imported functions */
+    LONGLONG relocations;   /* time spent relocating modules */
+    LONGLONG attach;        /* time spent in process attach */
+    ULONG    import_count;  /* number of imported functions resolved */
+    ULONG    reloc_count;   /* number of modules relocated */
+    ULONG    attach_count;  /* number of modules attached */
+} loader_times;
+static int attach_depth;
+
+static inline LONGLONG loader_perf_counter(void)
+{
+    LARGE_INTEGER counter;
+
+    if (!TRACE_ON(loader_perf)) return 0;
+    NtQueryPerformanceCounter( &counter, NULL );
+    return counter.QuadPart;
+}
+
+/***********************************************************************
+ *           dump_loader_times
+ */
+static void dump_loader_times( const char *when )
+{
+    if (!TRACE_ON(loader_perf)) return;
+    TRACE_(loader_perf)( "%s: imports %u functions in %u.%04u ms, relocations %u modules in %u.%04u ms, "
+                         "attach %u modules in %u.%04u ms\n", when,
+                         loader_times.import_count, (UINT)(loader_times.imports / 10000),
+                         (UINT)(loader_times.imports % 10000),
+                         loader_times.reloc_count, (UINT)(loader_times.relocations / 10000),
+                         (UINT)(loader_times.relocations % 10000),
+                         loader_times.attach_count, (UINT)(loader_times.attach / 10000),
+                         (UINT)(loader_times.attach % 10000) );
+}
+
 /* info about the current builtin dll load */
 /* used to keep track of things across the register_dll constructor call */
 struct builtin_load_info
@@ -606,6 +649,44 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
 }
 
 
+/*************************************************************************
+ *		hash_export_name
+ */
+static inline DWORD hash_export_name( const char *name )
+{
+    DWORD hash = 0;
+
+    while (*name) hash = hash * 33 + (unsigned char)*name++;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		build_export_hash
+ *
+ * Build the hash table of the exported names of a module.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL build_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( wm->ldr.BaseAddress, exports->AddressOfNames );
+    DWORD i, pos, size = 64;
+
+    while (size < 2 * exports->NumberOfNames) size *= 2;
+    if (!(wm->export_hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(DWORD) )))
+        return FALSE;
+    wm->export_hash_mask = size - 1;
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        pos = hash_export_name( get_rva( wm->ldr.BaseAddress, names[i] )) & wm->export_hash_mask;
+        while (wm->export_hash[pos]) pos = (pos + 1) & wm->export_hash_mask;
+        wm->export_hash[pos] = i + 1;
+    }
+    return TRUE;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -618,6 +699,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int min = 0, max = exports->NumberOfNames - 1;
+    WINE_MODREF *wm;
 
     /* first check the hint */
     if (hint >= 0 && hint <= max)
@@ -627,7 +709,23 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
+    /* then look it up in the hash table */
+    if (exports->NumberOfNames >= MIN_EXPORT_HASH_NAMES && (wm = get_modref( module )) &&
+        (wm->export_hash || build_export_hash( wm, exports )))
+    {
+        DWORD index, pos = hash_export_name( name ) & wm->export_hash_mask;
+
+        while ((index = wm->export_hash[pos]))
+        {
+            char *ename = get_rva( module, names[index - 1] );
+            if (!strcmp( ename, name ))
+                return find_ordinal_export( module, exports, exp_size, ordinals[index - 1], load_path );
+            pos = (pos + 1) & wm->export_hash_mask;
+        }
+        return NULL;
+    }
+
+    /* or do a binary search */
     while (min <= max)
     {
         int res, pos = (min + max) / 2;
@@ -663,6 +761,7 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
     PVOID protect_base;
     SIZE_T protect_size = 0;
     DWORD protect_old;
+    LONGLONG start;
 
     thunk_list = get_rva( module, (DWORD)descr->FirstThunk );
     if (descr->u.OriginalFirstThunk)
@@ -706,9 +805,12 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         return FALSE;
     }
 
+    start = loader_perf_counter();
+
     /* unprotect the import address table since it can be located in
      * readonly section */
     while (import_list[protect_size].u1.Ordinal) protect_size++;
+    loader_times.import_count += protect_size;
     protect_base = thunk_list;
     protect_size *= sizeof(*thunk_list);
     NtProtectVirtualMemory( NtCurrentProcess(), &protect_base,
@@ -784,6 +886,7 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
 done:
     /* restore old protection of the import address table */
     NtProtectVirtualMemory( NtCurrentProcess(), &protect_base, &protect_size, protect_old, &protect_old );
+    loader_times.imports += loader_perf_counter() - start;
     *pwm = wmImp;
     return TRUE;
 }
@@ -1277,6 +1380,7 @@ static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved )
 {
     NTSTATUS status = STATUS_SUCCESS;
     ULONG_PTR cookie;
+    LONGLONG start = 0;
     int i;
 
     if (process_detaching) return status;
@@ -1288,6 +1392,9 @@ static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved )
 
     TRACE("(%s,%p) - START\n", debugstr_w(wm->ldr.BaseDllName.Buffer), lpReserved );
 
+    /* only time the outermost call, dependencies are attached recursively */
+    if (!attach_depth++) start = loader_perf_counter();
+
     /* Tag current MODREF to prevent recursive loop */
     wm->ldr.Flags |= LDR_LOAD_IN_PROGRESS;
     if (lpReserved) wm->ldr.LoadCount = -1;  /* pin it if imported by the main exe */
@@ -1312,6 +1419,7 @@ static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved )
 
         call_ldr_notifications( LDR_DLL_NOTIFICATION_REASON_LOADED, &wm->ldr );
         status = MODULE_InitDLL( wm, DLL_PROCESS_ATTACH, lpReserved );
+        loader_times.attach_count++;
         if (status == STATUS_SUCCESS)
         {
             wm->ldr.Flags |= LDR_PROCESS_ATTACHED;
@@ -1331,6 +1439,7 @@ static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved )
     if (wm->ldr.ActivationContext) RtlDeactivateActivationContext( 0, cookie );
     /* Remove recursion flag */
     wm->ldr.Flags &= ~LDR_LOAD_IN_PROGRESS;
+    if (!--attach_depth) loader_times.attach += loader_perf_counter() - start;
 
     TRACE("(%s,%p) - END\n", debugstr_w(wm->ldr.BaseDllName.Buffer), lpReserved );
     return status;
@@ -1990,7 +2099,13 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
     /* perform base relocation, if necessary */
 
     if (status == STATUS_IMAGE_NOT_AT_BASE)
+    {
+        LONGLONG start = loader_perf_counter();
+
         status = perform_relocations( module, len );
+        loader_times.relocations += loader_perf_counter() - start;
+        loader_times.reloc_count++;
+    }
 
     if (status != STATUS_SUCCESS)
     {
@@ -2960,6 +3075,7 @@ fail:
 void WINAPI LdrShutdownProcess(void)
 {
     TRACE("()\n");
+    dump_loader_times( "process exit" );
     process_detaching = TRUE;
     process_detach();
 }
@@ -3056,6 +3172,7 @@ static void free_modref( WINE_MODREF *wm )
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
     RtlFreeHeap( GetProcessHeap(), 0, wm->deps );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
@@ -3254,6 +3371,7 @@ NTSTATUS attach_dlls( CONTEXT *context, void **entry )
         }
         attach_implicitly_loaded_dlls( context );
         virtual_release_address_space();
+        dump_loader_times( "process init" );
     }
     else
     {
@@ -270,9 +270,38 @@ static void read_reply_data( void *buffer, size_t size )
  */
 static inline unsigned int wait_reply( struct __server_request_info *req )
 {
-    read_reply_data( &req->u.reply, sizeof(req->u.reply) );
-    if (req->u.reply.reply_header.reply_size)
-        read_reply_data( req->reply_data, req->u.reply.reply_header.reply_size );
+    /* the reply overwrites the request, so save the buffer size first */
+    data_size_t max_size = req->u.req.request_header.reply_size;
+    struct iovec vec[2];
+    int ret;
+
+    /* the server sends the reply header and data with a single writev, try to
+     * get both of them with a single system call */
+    vec[0].iov_base = &req->u.reply;
+    vec[0].iov_len  = sizeof(req->u.reply);
+    vec[1].iov_base = req->reply_data;
+    vec[1].iov_len  = max_size;
+
+    for (;;)
+    {
+        if ((ret = readv( ntdll_get_thread_data()->reply_fd, vec, max_size ? 2 : 1 )) > 0) break;
+        if (!ret) abort_thread(0);  /* the server closed the connection; time to die... */
+        if (errno == EINTR) continue;
+        if (errno == EPIPE) abort_thread(0);
+        server_protocol_perror("read");
+    }
+
+    if (ret < sizeof(req->u.reply))
+    {
+        read_reply_data( (char *)&req->u.reply + ret, sizeof(req->u.reply) - ret );
+        ret = 0;
+    }
+    else ret -= sizeof(req->u.reply);
+
+    if (ret > req->u.reply.reply_header.reply_size)
+        server_protocol_error( "reply data overflow %d\n", ret );
+    if (req->u.reply.reply_header.reply_size > ret)
+        read_reply_data( (char *)req->reply_data + ret, req->u.reply.reply_header.reply_size - ret );
     return req->u.reply.reply_header.error;
 }
 
@@ -814,13 +843,15 @@ union fd_cache_entry
     struct
     {
         int fd;
-        enum server_fd_type type : 5;
+        enum server_fd_type type : 4;
+        unsigned int        skip_completion : 1;  /* FILE_SKIP_COMPLETION_PORT_ON_SUCCESS is set */
         unsigned int        access : 3;
         unsigned int        options : 24;
     } s;
 };
 
 C_ASSERT( sizeof(union fd_cache_entry) == sizeof(LONG64) );
+C_ASSERT( FD_TYPE_NB_TYPES <= 16 );
 
 #define FD_CACHE_BLOCK_SIZE  (65536 / sizeof(union fd_cache_entry))
 #define FD_CACHE_ENTRIES     128
@@ -842,7 +873,7 @@ static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
  * Caller must hold fd_cache_section.
  */
 static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
-                            unsigned int access, unsigned int options )
+                            unsigned int access, unsigned int options, unsigned int comp_flags )
 {
     unsigned int entry, idx = handle_to_index( handle, &entry );
     union fd_cache_entry cache;
@@ -868,6 +899,7 @@ static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
     /* store fd+1 so that 0 can be used as the unset value */
     cache.s.fd = fd + 1;
     cache.s.type = type;
+    cache.s.skip_completion = !!(comp_flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS);
     cache.s.access = access;
     cache.s.options = options;
     cache.data = interlocked_xchg64( &fd_cache[entry][idx].data, cache.data );
@@ -901,6 +933,48 @@ static inline NTSTATUS get_cached_fd( HANDLE handle, int *fd, enum server_fd_typ
 }
 
 
+/***********************************************************************
+ *           server_skip_fd_completion
+ *
+ * Check whether the fd cache knows that the server drops completions of
+ * synchronously completed I/O on this handle, so that they needn't be sent.
+ */
+BOOL server_skip_fd_completion( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry cache;
+
+    if (entry >= FD_CACHE_ENTRIES || !fd_cache[entry]) return FALSE;
+
+    cache.data = interlocked_cmpxchg64( &fd_cache[entry][idx].data, 0, 0 );
+    return cache.s.type != FD_TYPE_INVALID && cache.s.skip_completion;
+}
+
+
+/***********************************************************************
+ *           server_set_fd_skip_completion
+ *
+ * Update the cached entry once FILE_SKIP_COMPLETION_PORT_ON_SUCCESS has been
+ * set on the handle. The server never clears it again.
+ */
+void server_set_fd_skip_completion( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry cache, prev;
+
+    if (entry >= FD_CACHE_ENTRIES || !fd_cache[entry]) return;
+
+    for (;;)
+    {
+        prev.data = interlocked_cmpxchg64( &fd_cache[entry][idx].data, 0, 0 );
+        if (prev.s.type == FD_TYPE_INVALID || prev.s.skip_completion) return;
+        cache = prev;
+        cache.s.skip_completion = 1;
+        if (interlocked_cmpxchg64( &fd_cache[entry][idx].data, cache.data, prev.data ) == prev.data) return;
+    }
+}
+
+
 /***********************************************************************
  *           server_remove_fd_from_cache
  */
@@ -920,6 +994,64 @@ int server_remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************
+ *           server_enter_fd_cache_section
+ *
+ * Must be held around requests whose reply may carry a unix fd, so that
+ * no other thread receives that fd in its place.
+ */
+void server_enter_fd_cache_section( sigset_t *sigset )
+{
+    server_enter_uninterrupted_section( &fd_cache_section, sigset );
+}
+
+
+/***********************************************************************
+ *           server_leave_fd_cache_section
+ */
+void server_leave_fd_cache_section( sigset_t *sigset )
+{
+    server_leave_uninterrupted_section( &fd_cache_section, sigset );
+}
+
+
+/***********************************************************************
+ *           server_cache_prefetched_fd
+ *
+ * Receive the unix fd that the server sent along with a reply that opened
+ * a handle, and store it in the cache.
+ * Caller must hold fd_cache_section.
+ */
+void server_cache_prefetched_fd( HANDLE handle, enum server_fd_type type,
+                                 unsigned int access, unsigned int options )
+{
+    obj_handle_t fd_handle;
+    int fd;
+
+    if (type == FD_TYPE_INVALID) return;
+    if ((fd = receive_fd( &fd_handle )) == -1) return;
+    assert( wine_server_ptr_handle(fd_handle) == handle );
+    if (!add_fd_to_cache( handle, fd, type, access, options, 0 )) close( fd );
+}
+
+
+/***********************************************************************
+ *           count_fd_cache_lookup
+ *
+ * Keep hit statistics for the fd cache, reported with +server.
+ */
+static void count_fd_cache_lookup( BOOL hit )
+{
+    static LONG hits, lookups;
+    LONG count;
+
+    if (hit) interlocked_xchg_add( &hits, 1 );
+    count = interlocked_xchg_add( &lookups, 1 ) + 1;
+    if (!(count % 1024))
+        TRACE( "fd cache: %d hits in %d lookups\n", *(volatile LONG *)&hits, count );
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -938,6 +1070,7 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
     wanted_access &= FILE_READ_DATA | FILE_WRITE_DATA | FILE_APPEND_DATA;
 
     ret = get_cached_fd( handle, &fd, type, &access, options );
+    if (TRACE_ON(server)) count_fd_cache_lookup( ret != STATUS_INVALID_HANDLE );
     if (ret != STATUS_INVALID_HANDLE) goto done;
 
     server_enter_uninterrupted_section( &fd_cache_section, &sigset );
@@ -956,14 +1089,14 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
                 {
                     assert( wine_server_ptr_handle(fd_handle) == handle );
                     *needs_close = (!reply->cacheable ||
-                                    !add_fd_to_cache( handle, fd, reply->type,
-                                                      reply->access, reply->options ));
+                                    !add_fd_to_cache( handle, fd, reply->type, reply->access,
+                                                      reply->options, reply->comp_flags ));
                 }
                 else ret = STATUS_TOO_MANY_OPENED_FILES;
             }
             else if (reply->cacheable)
             {
-                add_fd_to_cache( handle, ret, FD_TYPE_INVALID, 0, 0 );
+                add_fd_to_cache( handle, ret, FD_TYPE_INVALID, 0, 0, 0 );
             }
         }
         SERVER_END_REQ;
@@ -1416,16 +1416,21 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE CompletionPort, IO_COMPLETION_INFORM
 }
 
 NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
-                              NTSTATUS CompletionStatus, ULONG Information )
+                              NTSTATUS CompletionStatus, ULONG Information, BOOL async )
 {
     NTSTATUS status;
 
+    /* the server would drop it anyway */
+    if (!async && CompletionStatus == STATUS_SUCCESS && server_skip_fd_completion( hFile ))
+        return STATUS_SUCCESS;
+
     SERVER_START_REQ( add_fd_completion )
     {
         req->handle      = wine_server_obj_handle( hFile );
         req->cvalue      = CompletionValue;
         req->status      = CompletionStatus;
         req->information = Information;
+        req->async       = async;
         status = wine_server_call( req );
     }
     SERVER_END_REQ;
@@ -1301,6 +1301,12 @@ typedef struct tagTLBContext
 	void *mapping;        /* memory mapping */
 	MSFT_SegDir * pTblDir;
 	ITypeLibImpl* pLibInfo;
+	TLBString **names;    /* name table entries, in offset order */
+	int num_names;
+	TLBString **strings;  /* string table entries, in offset order */
+	int num_strings;
+	TLBGuid **guids;      /* guid table entries, indexed by offset */
+	int num_guids;
 } TLBContext;
 
 
@@ -2073,6 +2079,9 @@ static HRESULT MSFT_ReadAllGuids(TLBContext *pcx)
     MSFT_GuidEntry entry;
     int offs = 0;
 
+    pcx->guids = heap_alloc((max(pcx->pTblDir->pGuidTab.length, 0) / sizeof(MSFT_GuidEntry) + 1) * sizeof(TLBGuid *));
+    if (!pcx->guids) return E_OUTOFMEMORY;
+
     MSFT_Seek(pcx, pcx->pTblDir->pGuidTab.offset);
     while (1) {
         if (offs >= pcx->pTblDir->pGuidTab.length)
@@ -2087,6 +2096,7 @@ static HRESULT MSFT_ReadAllGuids(TLBContext *pcx)
         guid->hreftype = entry.hreftype;
 
         list_add_tail(&pcx->pLibInfo->guid_list, &guid->entry);
+        pcx->guids[pcx->num_guids++] = guid;
 
         offs += sizeof(MSFT_GuidEntry);
     }
@@ -2096,14 +2106,14 @@ static TLBGuid *MSFT_ReadGuid( int offset, TLBContext *pcx)
 {
     TLBGuid *ret;
 
-    LIST_FOR_EACH_ENTRY(ret, &pcx->pLibInfo->guid_list, TLBGuid, entry){
-        if(ret->offset == offset){
-            TRACE_(typelib)("%s\n", debugstr_guid(&ret->guid));
-            return ret;
-        }
-    }
+    /* guid entries have a fixed size, so the offset gives the index */
+    if (offset < 0 || offset % sizeof(MSFT_GuidEntry) ||
+        offset / sizeof(MSFT_GuidEntry) >= pcx->num_guids)
+        return NULL;
 
-    return NULL;
+    ret = pcx->guids[offset / sizeof(MSFT_GuidEntry)];
+    TRACE_(typelib)("%s\n", debugstr_guid(&ret->guid));
+    return ret;
 }
 
 static HREFTYPE MSFT_ReadHreftype( TLBContext *pcx, int offset )
@@ -2129,6 +2139,10 @@ static HRESULT MSFT_ReadAllNames(TLBContext *pcx)
     INT16 len_piece;
     int offs = 0, lengthInChars;
 
+    /* entries take at least 8 bytes */
+    pcx->names = heap_alloc((max(pcx->pTblDir->pNametab.length, 0) / 8 + 1) * sizeof(TLBString *));
+    if (!pcx->names) return E_OUTOFMEMORY;
+
     MSFT_Seek(pcx, pcx->pTblDir->pNametab.offset);
     while (1) {
         TLBString *tlbstr;
@@ -2164,37 +2178,41 @@ static HRESULT MSFT_ReadAllNames(TLBContext *pcx)
         heap_free(string);
 
         list_add_tail(&pcx->pLibInfo->name_list, &tlbstr->entry);
+        pcx->names[pcx->num_names++] = tlbstr;
 
         offs += len_piece;
     }
 }
 
-static TLBString *MSFT_ReadName( TLBContext *pcx, int offset)
+/* binary search in a table of strings sorted by offset */
+static TLBString *MSFT_FindString( TLBString **table, int count, int offset )
 {
-    TLBString *tlbstr;
+    int low = 0, high = count - 1;
 
-    LIST_FOR_EACH_ENTRY(tlbstr, &pcx->pLibInfo->name_list, TLBString, entry) {
-        if (tlbstr->offset == offset) {
-            TRACE_(typelib)("%s\n", debugstr_w(tlbstr->str));
-            return tlbstr;
+    while (low <= high)
+    {
+        int mid = (low + high) / 2;
+
+        if (table[mid]->offset == offset)
+        {
+            TRACE_(typelib)("%s\n", debugstr_w(table[mid]->str));
+            return table[mid];
         }
+        if (table[mid]->offset < (UINT)offset) low = mid + 1;
+        else high = mid - 1;
     }
 
     return NULL;
 }
 
-static TLBString *MSFT_ReadString( TLBContext *pcx, int offset)
+static TLBString *MSFT_ReadName( TLBContext *pcx, int offset)
 {
-    TLBString *tlbstr;
-
-    LIST_FOR_EACH_ENTRY(tlbstr, &pcx->pLibInfo->string_list, TLBString, entry) {
-        if (tlbstr->offset == offset) {
-            TRACE_(typelib)("%s\n", debugstr_w(tlbstr->str));
-            return tlbstr;
-        }
-    }
+    return MSFT_FindString(pcx->names, pcx->num_names, offset);
+}
 
-    return NULL;
+static TLBString *MSFT_ReadString( TLBContext *pcx, int offset)
+{
+    return MSFT_FindString(pcx->strings, pcx->num_strings, offset);
 }
 
 /*
@@ -2755,6 +2773,10 @@ static HRESULT MSFT_ReadAllStrings(TLBContext *pcx)
     INT16 len_str, len_piece;
     int offs = 0, lengthInChars;
 
+    /* entries take at least 8 bytes */
+    pcx->strings = heap_alloc((max(pcx->pTblDir->pStringtab.length, 0) / 8 + 1) * sizeof(TLBString *));
+    if (!pcx->strings) return E_OUTOFMEMORY;
+
     MSFT_Seek(pcx, pcx->pTblDir->pStringtab.offset);
     while (1) {
         TLBString *tlbstr;
@@ -2789,6 +2811,7 @@ static HRESULT MSFT_ReadAllStrings(TLBContext *pcx)
         heap_free(string);
 
         list_add_tail(&pcx->pLibInfo->string_list, &tlbstr->entry);
+        pcx->strings[pcx->num_strings++] = tlbstr;
 
         offs += len_piece;
     }
@@ -3464,6 +3487,9 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
     cx.mapping = pLib;
     cx.pLibInfo = pTypeLibImpl;
     cx.length = dwTLBLength;
+    cx.names = cx.strings = NULL;
+    cx.guids = NULL;
+    cx.num_names = cx.num_strings = cx.num_guids = 0;
 
     /* read header */
     MSFT_ReadLEDWords(&tlbHeader, sizeof(tlbHeader), &cx, 0);
@@ -3656,6 +3682,10 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
     }
 #endif
 
+    heap_free(cx.names);
+    heap_free(cx.strings);
+    heap_free(cx.guids);
+
     TRACE("(%p)\n", pTypeLibImpl);
     return &pTypeLibImpl->ITypeLib2_iface;
 }
@@ -58,6 +58,12 @@ typedef struct regexp_t {
     struct RECharSet    *classList;    /* list of [...] bitmaps */
     const WCHAR         *source;       /* locked source string, sans // */
     DWORD               source_len;
+    BYTE                startType;     /* how to find match candidates, see REStartType */
+    WCHAR               startChar;     /* first char of every match, if known */
+    size_t              startClass;    /* class every match starts with, if known */
+    const WCHAR         *prefix;       /* literal every match starts with, if known */
+    size_t              prefixLength;
+    BYTE                prefixShift[256]; /* Horspool shifts by low byte of char */
     jsbytecode          program[1];    /* regular expression bytecode */
 } regexp_t;
 
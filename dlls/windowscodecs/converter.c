@@ -93,6 +93,64 @@ static inline float to_sRGB_component(float f)
     return 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
 }
 
+/* srgb_thresholds[i] is the smallest value in [0,1] for which to_sRGB_byte returns i + 1 */
+static float srgb_thresholds[255];
+static INIT_ONCE srgb_thresholds_once = INIT_ONCE_STATIC_INIT;
+
+static inline BYTE to_sRGB_byte_slow(float f)
+{
+    return (BYTE)floorf(to_sRGB_component(f) * 255.0f + 0.51f);
+}
+
+static inline float float_from_bits(UINT bits)
+{
+    union { UINT bits; float f; } u;
+    u.bits = bits;
+    return u.f;
+}
+
+static BOOL WINAPI init_srgb_thresholds(INIT_ONCE *once, void *param, void **context)
+{
+    UINT i, low, high, mid;
+
+    /* the conversion is monotonic, and non-negative floats sort like their bit patterns */
+    for (i = 0; i < 255; i++)
+    {
+        low = 0;
+        high = 0x3f800000; /* 1.0f */
+        while (low < high)
+        {
+            mid = low + (high - low) / 2;
+            if (to_sRGB_byte_slow(float_from_bits(mid)) > i) high = mid;
+            else low = mid + 1;
+        }
+        srgb_thresholds[i] = float_from_bits(low);
+    }
+    return TRUE;
+}
+
+static inline void init_sRGB_byte(void)
+{
+    InitOnceExecuteOnce(&srgb_thresholds_once, init_srgb_thresholds, NULL, NULL);
+}
+
+/* same as to_sRGB_byte_slow, but without calling powf for values in [0,1];
+ * init_sRGB_byte must have been called */
+static inline BYTE to_sRGB_byte(float f)
+{
+    UINT low = 0, high = 255, mid;
+
+    if (!(f >= 0.0f && f <= 1.0f)) return to_sRGB_byte_slow(f);
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (f >= srgb_thresholds[mid]) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
 #if 0 /* FIXME: enable once needed */
 static void from_sRGB(BYTE *bgr)
 {
@@ -989,6 +1047,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                init_sRGB_byte();
                 for (y = 0; y < prc->Height; y++)
                 {
                     float *gray_float = (float *)src;
@@ -996,7 +1055,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1167,13 +1226,14 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                init_sRGB_byte();
                 for (y=0; y < prc->Height; y++)
                 {
                     float *srcpixel = (float*)src;
                     BYTE *dstpixel = dst;
 
                     for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+                        *dstpixel++ = to_sRGB_byte(*srcpixel++);
 
                     src += srcstride;
                     dst += cbStride;
@@ -1198,6 +1258,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
         INT x, y;
         BYTE *src = srcdata, *dst = pbBuffer;
 
+        init_sRGB_byte();
         for (y = 0; y < prc->Height; y++)
         {
             BYTE *bgr = src;
@@ -1206,8 +1267,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = to_sRGB_byte(gray);
                 bgr += 3;
             }
             src += srcstride;
@@ -179,14 +179,41 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
 {
     UINT i;
     UINT bytesperpixel = This->bpp/8;
-    UINT src_x, src_y;
+    UINT src_x, src_y, src_frac, step, step_frac;
+    const BYTE *src_row;
 
     src_y = dst_y * This->src_height / This->height - src_data_y;
+    src_row = src_data[src_y];
+
+    /* step through (dst_x + i) * src_width / width without dividing for every pixel */
+    src_x = dst_x * This->src_width / This->width - src_data_x;
+    src_frac = dst_x * This->src_width % This->width;
+    step = This->src_width / This->width;
+    step_frac = This->src_width % This->width;
 
     for (i=0; i<dst_width; i++)
     {
-        src_x = (dst_x + i) * This->src_width / This->width - src_data_x;
-        memcpy(pbBuffer + bytesperpixel * i, src_data[src_y] + bytesperpixel * src_x, bytesperpixel);
+        /* constant sizes let the compiler inline the common cases */
+        switch (bytesperpixel)
+        {
+        case 4:
+            memcpy(pbBuffer + 4 * i, src_row + 4 * src_x, 4);
+            break;
+        case 3:
+            memcpy(pbBuffer + 3 * i, src_row + 3 * src_x, 3);
+            break;
+        default:
+            memcpy(pbBuffer + bytesperpixel * i, src_row + bytesperpixel * src_x, bytesperpixel);
+            break;
+        }
+
+        src_x += step;
+        src_frac += step_frac;
+        if (src_frac >= This->width)
+        {
+            src_frac -= This->width;
+            src_x++;
+        }
     }
 }
 
@@ -21,6 +21,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 #define WINED3D_INITIAL_CS_SIZE 4096
 
@@ -408,6 +409,8 @@ struct wined3d_cs_update_sub_resource
     unsigned int sub_resource_idx;
     struct wined3d_box box;
     struct wined3d_sub_resource_data data;
+    void *heap_data;
+    BYTE copy_data[1];
 };
 
 struct wined3d_cs_add_dirty_texture_region
@@ -2316,6 +2319,20 @@ done:
     context_release(context);
 
     wined3d_resource_release(resource);
+    heap_free(op->heap_data);
+}
+
+static size_t wined3d_cs_get_update_size(const struct wined3d_resource *resource, const struct wined3d_box *box,
+        unsigned int row_pitch, unsigned int slice_pitch)
+{
+    const struct wined3d_format *format = resource->format;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+        return box->right - box->left;
+
+    return (box->back - box->front - 1) * (size_t)slice_pitch
+            + ((box->bottom - box->top - 1) / format->block_height) * (size_t)row_pitch
+            + ((box->right - box->left + format->block_width - 1) / format->block_width) * format->block_byte_count;
 }
 
 void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
@@ -2323,22 +2340,45 @@ void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_r
         unsigned int slice_pitch)
 {
     struct wined3d_cs_update_sub_resource *op;
+    size_t size = 0;
+    void *heap_data = NULL;
+
+    /* The data pointer may go away once we return. Copy it into the command
+     * stream if it's small, or into a separate heap block otherwise, so that
+     * we don't have to wait for the CS thread to read it. Fall back to
+     * waiting if the copy can't be made. */
+    if (cs->thread && cs->thread_id != GetCurrentThreadId())
+    {
+        size = wined3d_cs_get_update_size(resource, box, row_pitch, slice_pitch);
+        if (size > WINED3D_CS_INLINE_UPDATE_SIZE)
+        {
+            if ((heap_data = heap_alloc(size)))
+                memcpy(heap_data, data, size);
+            size = 0;
+        }
+    }
 
-    op = cs->ops->require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
+    op = cs->ops->require_space(cs, FIELD_OFFSET(struct wined3d_cs_update_sub_resource, copy_data[size]),
+            WINED3D_CS_QUEUE_MAP);
     op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
     op->resource = resource;
     op->sub_resource_idx = sub_resource_idx;
     op->box = *box;
     op->data.row_pitch = row_pitch;
     op->data.slice_pitch = slice_pitch;
-    op->data.data = data;
+    op->data.data = heap_data ? heap_data : data;
+    op->heap_data = heap_data;
+    if (size)
+    {
+        memcpy(op->copy_data, data, size);
+        op->data.data = op->copy_data;
+    }
 
     wined3d_resource_acquire(resource);
 
     cs->ops->submit(cs, WINED3D_CS_QUEUE_MAP);
-    /* The data pointer may go away, so we need to wait until it is read.
-     * Copying the data may be faster if it's small. */
-    cs->ops->finish(cs, WINED3D_CS_QUEUE_MAP);
+    if (!size && !heap_data)
+        cs->ops->finish(cs, WINED3D_CS_QUEUE_MAP);
 }
 
 static void wined3d_cs_exec_add_dirty_texture_region(struct wined3d_cs *cs, const void *data)
@@ -2609,7 +2649,10 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
     size_t queue_size = ARRAY_SIZE(queue->data);
     size_t header_size, packet_size, remaining;
     struct wined3d_cs_packet *packet;
+    LARGE_INTEGER stall_start;
+    BOOL stalled = FALSE;
 
+    stall_start.QuadPart = 0;
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     size = (size + header_size - 1) & ~(header_size - 1);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
@@ -2658,6 +2701,18 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
+        if (!stalled && TRACE_ON(d3d_perf))
+            QueryPerformanceCounter(&stall_start);
+        stalled = TRUE;
+        wined3d_pause();
+    }
+
+    if (stalled && TRACE_ON(d3d_perf))
+    {
+        LARGE_INTEGER now;
+
+        QueryPerformanceCounter(&now);
+        cs->stall_time += now.QuadPart - stall_start.QuadPart;
     }
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
@@ -2705,6 +2760,61 @@ static void poll_queries(struct wined3d_cs *cs)
     }
 }
 
+enum wined3d_cs_thread_state
+{
+    WINED3D_CS_THREAD_BUSY,
+    WINED3D_CS_THREAD_SPINNING,
+    WINED3D_CS_THREAD_IDLE,
+    WINED3D_CS_THREAD_STATE_COUNT,
+};
+
+struct wined3d_cs_stats
+{
+    enum wined3d_cs_thread_state state;
+    LARGE_INTEGER frequency, last, report;
+    LONGLONG time[WINED3D_CS_THREAD_STATE_COUNT];
+    LONGLONG stall_time;
+};
+
+static unsigned int wined3d_cs_stats_ms(const struct wined3d_cs_stats *stats, LONGLONG time)
+{
+    return time * 1000 / stats->frequency.QuadPart;
+}
+
+/* Account the time spent in the previous state, and report the totals once
+ * per second. Only called on state transitions, and only when the d3d_perf
+ * channel is enabled. */
+static void wined3d_cs_stats_set_state(const struct wined3d_cs *cs,
+        struct wined3d_cs_stats *stats, enum wined3d_cs_thread_state state)
+{
+    LARGE_INTEGER now;
+    LONGLONG stall_time;
+    unsigned int i;
+
+    if (stats->state == state)
+        return;
+
+    QueryPerformanceCounter(&now);
+    stats->time[stats->state] += now.QuadPart - stats->last.QuadPart;
+    stats->last = now;
+    stats->state = state;
+
+    if (now.QuadPart - stats->report.QuadPart < stats->frequency.QuadPart)
+        return;
+
+    stall_time = *(volatile LONGLONG *)&cs->stall_time;
+    TRACE_(d3d_perf)("CS thread busy %u ms, spinning %u ms, idle %u ms; producer stalled %u ms.\n",
+            wined3d_cs_stats_ms(stats, stats->time[WINED3D_CS_THREAD_BUSY]),
+            wined3d_cs_stats_ms(stats, stats->time[WINED3D_CS_THREAD_SPINNING]),
+            wined3d_cs_stats_ms(stats, stats->time[WINED3D_CS_THREAD_IDLE]),
+            wined3d_cs_stats_ms(stats, stall_time - stats->stall_time));
+
+    for (i = 0; i < WINED3D_CS_THREAD_STATE_COUNT; ++i)
+        stats->time[i] = 0;
+    stats->stall_time = stall_time;
+    stats->report = now;
+}
+
 static void wined3d_cs_wait_event(struct wined3d_cs *cs)
 {
     InterlockedExchange(&cs->waiting_for_event, TRUE);
@@ -2728,8 +2838,10 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
 {
     struct wined3d_cs_packet *packet;
     struct wined3d_cs_queue *queue;
+    struct wined3d_cs_stats stats;
     unsigned int spin_count = 0;
     struct wined3d_cs *cs = ctx;
+    BOOL perf = TRACE_ON(d3d_perf);
     enum wined3d_cs_op opcode;
     HMODULE wined3d_module;
     unsigned int poll = 0;
@@ -2743,6 +2855,15 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
 
     list_init(&cs->query_poll_list);
     cs->thread_id = GetCurrentThreadId();
+
+    memset(&stats, 0, sizeof(stats));
+    if (perf)
+    {
+        QueryPerformanceFrequency(&stats.frequency);
+        QueryPerformanceCounter(&stats.last);
+        stats.report = stats.last;
+    }
+
     for (;;)
     {
         if (++poll == WINED3D_CS_QUERY_POLL_INTERVAL)
@@ -2757,12 +2878,20 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
+                if (perf)
+                    wined3d_cs_stats_set_state(cs, &stats, WINED3D_CS_THREAD_SPINNING);
                 if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
+                {
+                    if (perf)
+                        wined3d_cs_stats_set_state(cs, &stats, WINED3D_CS_THREAD_IDLE);
                     wined3d_cs_wait_event(cs);
+                }
                 continue;
             }
         }
         spin_count = 0;
+        if (perf)
+            wined3d_cs_stats_set_state(cs, &stats, WINED3D_CS_THREAD_BUSY);
 
         tail = queue->tail;
         packet = (struct wined3d_cs_packet *)&queue->data[tail];
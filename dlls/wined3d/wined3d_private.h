@@ -3508,6 +3508,7 @@ enum wined3d_push_constants
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x100000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_INLINE_UPDATE_SIZE   0x10000u
 
 struct wined3d_cs_queue
 {
@@ -3543,6 +3544,10 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    /* Time the application thread spent waiting for queue space, in
+     * performance counter ticks. Only updated when d3d_perf tracing is on. */
+    LONGLONG stall_time;
 };
 
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
@@ -64,6 +64,12 @@
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
@@ -534,6 +540,9 @@ struct ws2_transmitfile_async
     TRANSMIT_FILE_BUFFERS buffers;
     DWORD                 flags;
     LARGE_INTEGER         offset;
+    BOOL                  use_sendfile;  /* file data can be sent with sendfile() */
+    BOOL                  more;          /* more data follows the current buffer */
+    BOOL                  corked;        /* the last data sent was marked with MSG_MORE */
     struct ws2_async      write;
 };
 
@@ -642,7 +651,7 @@ static int ws_protocol_info(SOCKET s, int unicode, WSAPROTOCOL_INFOW *buffer, in
 int WSAIOCTL_GetInterfaceCount(void);
 int WSAIOCTL_GetInterfaceName(int intNumber, char *intName);
 
-static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus, ULONG Information );
+static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus, ULONG Information, BOOL async );
 
 #define MAP_OPTION(opt) { WS_##opt, opt }
 
@@ -2459,7 +2468,7 @@ static NTSTATUS WS2_async_accept_recv( void *user, IO_STATUS_BLOCK *iosb, NTSTAT
         return status;
 
     if (wsa->cvalue)
-        WS_AddCompletion( HANDLE2SOCKET(wsa->listen_socket), wsa->cvalue, iosb->u.Status, iosb->Information );
+        WS_AddCompletion( HANDLE2SOCKET(wsa->listen_socket), wsa->cvalue, iosb->u.Status, iosb->Information, TRUE );
 
     release_async_io( &wsa->io );
     return status;
@@ -2922,6 +2931,93 @@ static NTSTATUS WS2_ReadFile(HANDLE hFile, PIO_STATUS_BLOCK io_status, char* buf
     return status;
 }
 
+#ifdef HAVE_SYS_SENDFILE_H
+/***********************************************************************
+ *     WS2_transmitfile_has_data        (INTERNAL)
+ *
+ * Check whether there is file data left to send after the header.
+ */
+static BOOL WS2_transmitfile_has_data( struct ws2_transmitfile_async *wsa )
+{
+    struct stat st;
+    off_t pos;
+    int file_fd;
+    BOOL ret = FALSE;
+
+    if (wine_server_handle_to_fd( wsa->file, FILE_READ_DATA, &file_fd, NULL )) return FALSE;
+    if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        pos = wsa->offset.QuadPart;
+    else
+        pos = lseek( file_fd, 0, SEEK_CUR );
+    if (pos != -1 && !fstat( file_fd, &st ) && S_ISREG(st.st_mode))
+        ret = st.st_size > pos;
+    wine_server_release_fd( wsa->file, file_fd );
+    return ret;
+}
+
+/***********************************************************************
+ *     WS2_transmitfile_sendfile        (INTERNAL)
+ *
+ * Send file data straight from the page cache instead of copying it
+ * through our buffer. Returns STATUS_NOT_SUPPORTED if that isn't possible
+ * for this file.
+ */
+static NTSTATUS WS2_transmitfile_sendfile( int fd, struct ws2_transmitfile_async *wsa )
+{
+    IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
+    size_t count = 0x7ffff000; /* the most Linux sends at once */
+    NTSTATUS status;
+    off_t offset;
+    ssize_t n;
+    int file_fd;
+
+    if ((status = wine_server_handle_to_fd( wsa->file, FILE_READ_DATA, &file_fd, NULL )))
+        return status;
+
+    /* when the size of the transfer is limited ensure that we don't go past that limit */
+    if (wsa->file_bytes != 0)
+        count = min(count, wsa->file_bytes - wsa->file_read);
+
+    do
+    {
+        if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        {
+            offset = wsa->offset.QuadPart;
+            n = sendfile( fd, file_fd, &offset, count );
+        }
+        else
+            n = sendfile( fd, file_fd, NULL, count );
+    }
+    while (n == -1 && errno == EINTR);
+
+    wine_server_release_fd( wsa->file, file_fd );
+
+    if (n == -1)
+    {
+        if (errno == EAGAIN) return STATUS_PENDING;
+        if (!wsa->file_read && (errno == EINVAL || errno == ENOSYS)) return STATUS_NOT_SUPPORTED;
+        return wsaErrStatus();
+    }
+
+    if (!n)
+    {
+        wsa->file = NULL; /* continue on to the footer */
+        return STATUS_SUCCESS;
+    }
+
+    if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        wsa->offset.QuadPart += n;
+    wsa->file_read += n;
+    wsa->corked = FALSE;
+    if (iosb) iosb->Information += n;
+
+    if (wsa->file_bytes != 0 && wsa->file_read >= wsa->file_bytes)
+        wsa->file = NULL;
+
+    return STATUS_PENDING;
+}
+#endif
+
 /***********************************************************************
  *     WS2_transmitfile_getbuffer       (INTERNAL)
  *
@@ -2941,10 +3037,27 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
         wsa->write.iovec[0].iov_base = wsa->buffers.Head;
         wsa->write.iovec[0].iov_len  = wsa->buffers.HeadLength;
         wsa->buffers.Head            = NULL;
+#ifdef HAVE_SYS_SENDFILE_H
+        /* let the kernel merge the header with the start of the file */
+        wsa->more = wsa->file && wsa->use_sendfile && WS2_transmitfile_has_data( wsa );
+#endif
         return STATUS_PENDING;
     }
 
+    wsa->more = FALSE;
+
     /* process the main file */
+#ifdef HAVE_SYS_SENDFILE_H
+    if (wsa->file && wsa->use_sendfile)
+    {
+        NTSTATUS status = WS2_transmitfile_sendfile( fd, wsa );
+
+        if (status == STATUS_NOT_SUPPORTED)
+            wsa->use_sendfile = FALSE;
+        else if (status != STATUS_SUCCESS)
+            return status;
+    }
+#endif
     if (wsa->file)
     {
         DWORD bytes_per_send = wsa->bytes_per_send;
@@ -2991,6 +3104,15 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
         return STATUS_PENDING;
     }
 
+#ifdef TCP_CORK
+    if (wsa->corked)
+    {
+        /* the file turned out to be empty, push out the header */
+        int off = 0;
+        setsockopt( fd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off) );
+        wsa->corked = FALSE;
+    }
+#endif
     return STATUS_SUCCESS;
 }
 
@@ -3004,15 +3126,20 @@ static NTSTATUS WS2_transmitfile_base( int fd, struct ws2_transmitfile_async *ws
     NTSTATUS status;
 
     status = WS2_transmitfile_getbuffer( fd, wsa );
-    if (status == STATUS_PENDING)
+    if (status == STATUS_PENDING && wsa->write.first_iovec < wsa->write.n_iovecs)
     {
         IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
+        int flags = convert_flags(wsa->write.flags);
         int n;
 
-        n = WS2_send( fd, &wsa->write, convert_flags(wsa->write.flags) );
+#ifdef MSG_MORE
+        if (wsa->more) flags |= MSG_MORE;
+#endif
+        n = WS2_send( fd, &wsa->write, flags );
         if (n >= 0)
         {
             if (iosb) iosb->Information += n;
+            wsa->corked = wsa->more;
         }
         else if (errno != EAGAIN)
             return wsaErrStatus();
@@ -3108,6 +3235,9 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     wsa->bytes_per_send        = bytes_per_send;
     wsa->flags                 = flags;
     wsa->offset.QuadPart       = FILE_USE_FILE_POINTER_POSITION;
+    wsa->use_sendfile          = (h != NULL);
+    wsa->more                  = FALSE;
+    wsa->corked                = FALSE;
     wsa->write.hSocket         = SOCKET2HANDLE(s);
     wsa->write.addr            = NULL;
     wsa->write.addrlen.val     = 0;
@@ -3591,7 +3721,7 @@ static BOOL WINAPI WS2_ConnectEx(SOCKET s, const struct WS_sockaddr* name, int n
             {
                 ov->Internal = _get_sock_error(s, FD_CONNECT_BIT);
                 ov->InternalHigh = 0;
-                if (cvalue) WS_AddCompletion( s, cvalue, ov->Internal, ov->InternalHigh );
+                if (cvalue) WS_AddCompletion( s, cvalue, ov->Internal, ov->InternalHigh, TRUE );
                 if (ov->hEvent) NtSetEvent( ov->hEvent, NULL );
                 status = STATUS_PENDING;
             }
@@ -5082,7 +5212,7 @@ INT WINAPI WSAIoctl(SOCKET s, DWORD code, LPVOID in_buff, DWORD in_size, LPVOID
         overlapped->Internal = status;
         overlapped->InternalHigh = total;
         if (overlapped->hEvent) NtSetEvent( overlapped->hEvent, NULL );
-        if (cvalue) WS_AddCompletion( HANDLE2SOCKET(s), cvalue, status, total );
+        if (cvalue) WS_AddCompletion( HANDLE2SOCKET(s), cvalue, status, total, FALSE );
     }
 
     if (!status)
@@ -5477,7 +5607,7 @@ int WINAPI WSAPoll(WSAPOLLFD *wfds, ULONG count, int timeout)
 
 /* helper to send completion messages for client-only i/o operation case */
 static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus,
-                              ULONG Information )
+                              ULONG Information, BOOL async )
 {
     SERVER_START_REQ( add_fd_completion )
     {
@@ -5485,6 +5615,7 @@ static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS C
         req->cvalue      = CompletionValue;
         req->status      = CompletionStatus;
         req->information = Information;
+        req->async       = async;
         wine_server_call( req );
     }
     SERVER_END_REQ;
@@ -5629,7 +5760,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
         if (lpNumberOfBytesSent) *lpNumberOfBytesSent = n;
         if (!wsa->completion_func)
         {
-            if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n );
+            if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n, FALSE );
             if (lpOverlapped->hEvent) SetEvent( lpOverlapped->hEvent );
             HeapFree( GetProcessHeap(), 0, wsa );
         }
@@ -8046,7 +8177,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             iosb->Information = n;
             if (!wsa->completion_func)
             {
-                if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n );
+                if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n, FALSE );
                 if (lpOverlapped->hEvent) SetEvent( lpOverlapped->hEvent );
                 HeapFree( GetProcessHeap(), 0, wsa );
             }
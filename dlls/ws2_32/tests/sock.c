@@ -92,6 +92,9 @@ static DWORD (WINAPI *pGetIpForwardTable)(PMIB_IPFORWARDTABLE,PULONG,BOOL);
 /* Function pointers from ntdll */
 static DWORD (WINAPI *pNtClose)(HANDLE);
 
+/* Function pointers from kernel32 */
+static BOOL (WINAPI *pSetFileCompletionNotificationModes)(HANDLE,UCHAR);
+
 /**************** Structs and typedefs ***************/
 
 typedef struct thread_info
@@ -1312,6 +1315,9 @@ static void Init (void)
     if (ntdll)
         pNtClose = (void *)GetProcAddress(ntdll, "NtClose");
 
+    pSetFileCompletionNotificationModes = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"),
+                                                                 "SetFileCompletionNotificationModes");
+
     ok ( WSAStartup ( ver, &data ) == 0, "WSAStartup failed\n" );
     tls = TlsAlloc();
 }
@@ -8964,6 +8970,27 @@ static void test_TransmitFile(void)
     ok(memcmp(buf, &footer_msg[0], sizeof(footer_msg)) == 0,
        "TransmitFile footer buffer did not match!\n");
 
+    /* Test TransmitFile with a limited number of bytes from the current file position */
+    if (file_size > 30)
+    {
+        char buf2[20];
+
+        SetFilePointer(file, 10, NULL, FILE_BEGIN);
+        bret = pTransmitFile(client, file, sizeof(buf2), 0, NULL, &buffers, 0);
+        ok(bret, "TransmitFile failed unexpectedly.\n");
+        iret = recv(dest, buf, sizeof(header_msg), 0);
+        ok(memcmp(buf, &header_msg[0], sizeof(header_msg)) == 0,
+           "TransmitFile header buffer did not match!\n");
+        iret = recv(dest, buf, sizeof(buf2), 0);
+        ok(iret == sizeof(buf2), "Returned an unexpected buffer from TransmitFile: %d\n", iret);
+        SetFilePointer(file, 10, NULL, FILE_BEGIN);
+        ReadFile(file, buf2, sizeof(buf2), &num_bytes, NULL);
+        ok(memcmp(buf, buf2, sizeof(buf2)) == 0, "TransmitFile file data did not match!\n");
+        iret = recv(dest, buf, sizeof(footer_msg), 0);
+        ok(memcmp(buf, &footer_msg[0], sizeof(footer_msg)) == 0,
+           "TransmitFile footer buffer did not match!\n");
+    }
+
     /* Test overlapped TransmitFile */
     ov.hEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
     if (ov.hEvent == INVALID_HANDLE_VALUE)
@@ -10430,6 +10457,77 @@ static void test_completion_port(void)
     CloseHandle(previous_port);
 }
 
+static void test_completion_skip_on_success(void)
+{
+    HANDLE port;
+    WSAOVERLAPPED ov, *olp;
+    SOCKET src, dest;
+    char buf[16];
+    WSABUF bufs;
+    DWORD num_bytes, flags;
+    ULONG_PTR key;
+    BOOL bret;
+    int iret;
+
+    if (!pSetFileCompletionNotificationModes)
+    {
+        win_skip("SetFileCompletionNotificationModes not available\n");
+        return;
+    }
+
+    tcp_socketpair(&src, &dest);
+    if (src == INVALID_SOCKET || dest == INVALID_SOCKET)
+    {
+        skip("failed to create sockets\n");
+        return;
+    }
+
+    port = CreateIoCompletionPort((HANDLE)dest, NULL, 125, 0);
+    ok(port != NULL, "Failed to create completion port %u\n", GetLastError());
+
+    bret = pSetFileCompletionNotificationModes((HANDLE)dest, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS);
+    ok(bret, "SetFileCompletionNotificationModes failed, error %u\n", GetLastError());
+
+    iret = send(src, "testdata", 8, 0);
+    ok(iret == 8, "send returned %d\n", iret);
+    Sleep(100);
+
+    /* a receive that completes immediately doesn't queue a packet */
+    memset(&ov, 0, sizeof(ov));
+    bufs.len = sizeof(buf);
+    bufs.buf = buf;
+    flags = 0;
+    num_bytes = 0xdeadbeef;
+    iret = WSARecv(dest, &bufs, 1, &num_bytes, &flags, &ov, NULL);
+    ok(!iret, "WSARecv failed, error %d\n", WSAGetLastError());
+    ok(num_bytes == 8, "got %u bytes\n", num_bytes);
+
+    olp = (WSAOVERLAPPED *)0xdeadbeef;
+    bret = GetQueuedCompletionStatus(port, &num_bytes, &key, &olp, 100);
+    ok(!bret, "GetQueuedCompletionStatus succeeded\n");
+    ok(GetLastError() == WAIT_TIMEOUT, "Last error was %d\n", GetLastError());
+    ok(olp == NULL, "olp is %p\n", olp);
+
+    /* a pending receive still does */
+    iret = WSARecv(dest, &bufs, 1, &num_bytes, &flags, &ov, NULL);
+    ok(iret == SOCKET_ERROR, "WSARecv returned %d\n", iret);
+    ok(GetLastError() == ERROR_IO_PENDING, "Last error was %d\n", GetLastError());
+
+    iret = send(src, "testdata", 8, 0);
+    ok(iret == 8, "send returned %d\n", iret);
+
+    olp = NULL;
+    bret = GetQueuedCompletionStatus(port, &num_bytes, &key, &olp, 1000);
+    ok(bret, "GetQueuedCompletionStatus failed, error %u\n", GetLastError());
+    ok(key == 125, "Key is %lu\n", key);
+    ok(num_bytes == 8, "got %u bytes\n", num_bytes);
+    ok(olp == &ov, "Overlapped structure is at %p\n", olp);
+
+    closesocket(src);
+    closesocket(dest);
+    CloseHandle(port);
+}
+
 static void test_address_list_query(void)
 {
     SOCKET_ADDRESS_LIST *address_list;
@@ -11566,6 +11664,7 @@ START_TEST( sock )
     test_WSAAsyncGetServByName();
 
     test_completion_port();
+    test_completion_skip_on_success();
     test_address_list_query();
 
     /* this is an io heavy test, do it at the end so the kernel doesn't start dropping packets */
@@ -1432,7 +1432,9 @@ struct create_file_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    int          type;
+    unsigned int access;
+    unsigned int options;
 };
 
 
@@ -1499,6 +1501,8 @@ struct get_handle_fd_reply
     int          cacheable;
     unsigned int access;
     unsigned int options;
+    unsigned int comp_flags;
+    char __pad_28[4];
 };
 enum server_fd_type
 {
@@ -3293,6 +3297,34 @@ struct register_async_reply
 
 
 
+struct register_client_async_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+    async_data_t async;
+    unsigned int access;
+    char __pad_60[4];
+};
+struct register_client_async_reply
+{
+    struct reply_header __header;
+};
+
+
+
+struct wake_client_async_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+    client_ptr_t user;
+};
+struct wake_client_async_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct cancel_async_request
 {
     struct request_header __header;
@@ -5377,7 +5409,7 @@ struct add_fd_completion_request
     apc_param_t    cvalue;
     apc_param_t    information;
     unsigned int   status;
-    char __pad_36[4];
+    int            async;
 };
 struct add_fd_completion_reply
 {
@@ -5386,6 +5418,20 @@ struct add_fd_completion_reply
 
 
 
+struct set_fd_completion_mode_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+    unsigned int   flags;
+    char __pad_20[4];
+};
+struct set_fd_completion_mode_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct set_fd_disp_info_request
 {
     struct request_header __header;
@@ -5799,6 +5845,8 @@ enum request
     REQ_get_serial_info,
     REQ_set_serial_info,
     REQ_register_async,
+    REQ_register_client_async,
+    REQ_wake_client_async,
     REQ_cancel_async,
     REQ_get_async_result,
     REQ_read,
@@ -5922,6 +5970,7 @@ enum request
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
+    REQ_set_fd_completion_mode,
     REQ_set_fd_disp_info,
     REQ_set_fd_name_info,
     REQ_get_window_layered_info,
@@ -6096,6 +6145,8 @@ union generic_request
     struct get_serial_info_request get_serial_info_request;
     struct set_serial_info_request set_serial_info_request;
     struct register_async_request register_async_request;
+    struct register_client_async_request register_client_async_request;
+    struct wake_client_async_request wake_client_async_request;
     struct cancel_async_request cancel_async_request;
     struct get_async_result_request get_async_result_request;
     struct read_request read_request;
@@ -6219,6 +6270,7 @@ union generic_request
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
+    struct set_fd_completion_mode_request set_fd_completion_mode_request;
     struct set_fd_disp_info_request set_fd_disp_info_request;
     struct set_fd_name_info_request set_fd_name_info_request;
     struct get_window_layered_info_request get_window_layered_info_request;
@@ -6391,6 +6443,8 @@ union generic_reply
     struct get_serial_info_reply get_serial_info_reply;
     struct set_serial_info_reply set_serial_info_reply;
     struct register_async_reply register_async_reply;
+    struct register_client_async_reply register_client_async_reply;
+    struct wake_client_async_reply wake_client_async_reply;
     struct cancel_async_reply cancel_async_reply;
     struct get_async_result_reply get_async_result_reply;
     struct read_reply read_reply;
@@ -6514,6 +6568,7 @@ union generic_reply
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
+    struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
     struct set_fd_disp_info_reply set_fd_disp_info_reply;
     struct set_fd_name_info_reply set_fd_name_info_reply;
     struct get_window_layered_info_reply get_window_layered_info_reply;
@@ -6533,6 +6588,6 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 556
+#define SERVER_PROTOCOL_VERSION 559
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
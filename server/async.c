@@ -53,6 +53,7 @@ struct async
     int                  direct_result;   /* a flag if we're passing result directly from request instead of APC  */
     struct completion   *completion;      /* completion associated with fd */
     apc_param_t          comp_key;        /* completion key associated with fd */
+    unsigned int         comp_flags;      /* completion notification flags of the fd */
 };
 
 static void async_dump( struct object *obj, int verbose );
@@ -239,6 +240,7 @@ struct async *create_async( struct fd *fd, struct thread *thread, const async_da
     async->wait_handle   = 0;
     async->direct_result = 0;
     async->completion    = fd_get_completion( fd, &async->comp_key );
+    async->comp_flags    = fd_get_comp_flags( fd );
 
     if (iosb) async->iosb = (struct iosb *)grab_object( iosb );
     else async->iosb = NULL;
@@ -377,11 +379,13 @@ void async_set_result( struct object *obj, unsigned int status, apc_param_t tota
             data.user.args[2] = 0;
             thread_queue_apc( NULL, async->thread, NULL, &data );
         }
-        else if (async->data.apc_context)
+        else if (async->data.apc_context && !(async->direct_result && status == STATUS_SUCCESS &&
+                 (async->comp_flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)))
             add_async_completion( async, async->data.apc_context, status, total );
 
         if (async->event) set_event( async->event );
-        else if (async->fd) set_fd_signaled( async->fd, 1 );
+        else if (async->fd && !(async->comp_flags & FILE_SKIP_SET_EVENT_ON_HANDLE))
+            set_fd_signaled( async->fd, 1 );
         if (!async->signaled)
         {
             async->signaled = 1;
@@ -535,6 +539,20 @@ DECL_HANDLER(cancel_async)
     }
 }
 
+/* wake up an async created by register_client_async, the client then reports its result */
+DECL_HANDLER(wake_client_async)
+{
+    struct async *async;
+
+    LIST_FOR_EACH_ENTRY( async, &current->process->asyncs, struct async, process_entry )
+        if (async->data.user == req->user && async->status == STATUS_PENDING)
+        {
+            async_terminate( async, STATUS_ALERTED );
+            return;
+        }
+    set_error( STATUS_INVALID_PARAMETER );
+}
+
 /* get async result from associated iosb */
 DECL_HANDLER(get_async_result)
 {
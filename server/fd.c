@@ -194,6 +194,7 @@ struct fd
     struct async_queue   wait_q;      /* other async waiters of this fd */
     struct completion   *completion;  /* completion object attached to this fd */
     apc_param_t          comp_key;    /* completion key to set in completion events */
+    unsigned int         comp_flags;  /* completion notification flags (FILE_SKIP_*) */
 };
 
 static void fd_dump( struct object *obj, int verbose );
@@ -358,13 +359,16 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct list           entry;      /* entry in expired timeouts list */
+    int                   index;      /* index in the timeout heap, -1 once expired */
     timeout_t             when;       /* timeout expiry (absolute time) */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list timeout_list = LIST_INIT(timeout_list);   /* sorted timeouts list */
+static struct timeout_user **timeout_heap;  /* binary min-heap of pending timeouts */
+static int nb_timeouts;                     /* number of timeouts in the heap */
+static int allocated_timeouts;              /* allocated size of the heap array */
 timeout_t current_time;
 
 static inline void set_current_time(void)
@@ -375,32 +379,95 @@ static inline void set_current_time(void)
     current_time = (timeout_t)now.tv_sec * TICKS_PER_SEC + now.tv_usec * 10 + ticks_1601_to_1970;
 }
 
+/* store a timeout at a given position in the heap */
+static inline void set_timeout_heap_entry( int index, struct timeout_user *user )
+{
+    timeout_heap[index] = user;
+    user->index = index;
+}
+
+/* move a timeout up the heap until its parent expires before it */
+static void timeout_heap_sift_up( int index )
+{
+    struct timeout_user *user = timeout_heap[index];
+
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (timeout_heap[parent]->when <= user->when) break;
+        set_timeout_heap_entry( index, timeout_heap[parent] );
+        index = parent;
+    }
+    set_timeout_heap_entry( index, user );
+}
+
+/* move a timeout down the heap until its children expire after it */
+static void timeout_heap_sift_down( int index )
+{
+    struct timeout_user *user = timeout_heap[index];
+
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= nb_timeouts) break;
+        if (child + 1 < nb_timeouts && timeout_heap[child + 1]->when < timeout_heap[child]->when)
+            child++;
+        if (user->when <= timeout_heap[child]->when) break;
+        set_timeout_heap_entry( index, timeout_heap[child] );
+        index = child;
+    }
+    set_timeout_heap_entry( index, user );
+}
+
+/* remove the timeout at a given position from the heap */
+static void timeout_heap_remove( int index )
+{
+    struct timeout_user *last = timeout_heap[--nb_timeouts];
+
+    timeout_heap[index]->index = -1;
+    if (index == nb_timeouts) return;
+    set_timeout_heap_entry( index, last );
+    if (index > 0 && timeout_heap[(index - 1) / 2]->when > last->when)
+        timeout_heap_sift_up( index );
+    else
+        timeout_heap_sift_down( index );
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
 
+    if (nb_timeouts == allocated_timeouts)
+    {
+        int new_count = allocated_timeouts ? allocated_timeouts * 2 : 64;
+        struct timeout_user **new_heap;
+
+        if (!(new_heap = realloc( timeout_heap, new_count * sizeof(*new_heap) )))
+        {
+            set_error( STATUS_NO_MEMORY );
+            return NULL;
+        }
+        timeout_heap = new_heap;
+        allocated_timeouts = new_count;
+    }
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = (when > 0) ? when : current_time - when;
     user->callback = func;
     user->private  = private;
 
-    /* Now insert it in the linked list */
+    /* Now insert it in the heap */
 
-    LIST_FOR_EACH( ptr, &timeout_list )
-    {
-        struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-        if (timeout->when >= user->when) break;
-    }
-    list_add_before( ptr, &user->entry );
+    set_timeout_heap_entry( nb_timeouts++, user );
+    timeout_heap_sift_up( user->index );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->index != -1) timeout_heap_remove( user->index );
+    else list_remove( &user->entry );  /* already expired but callback not called yet */
     free( user );
 }
 
@@ -461,59 +528,141 @@ static inline void fd_poll_event( struct fd *fd, int event )
 
 static int epoll_fd = -1;
 
+/* state of a poll user as currently registered with epoll */
+struct epoll_user
+{
+    int fd;       /* unix fd registered with epoll, or -1 */
+    int events;   /* events registered with epoll */
+    int dirty;    /* registration needs to be updated */
+};
+
+static struct epoll_user *epoll_users;      /* per poll user epoll state */
+static int *epoll_dirty;                    /* poll users with pending changes */
+static int nb_epoll_dirty;                  /* number of poll users with pending changes */
+static int allocated_epoll_users;           /* count of allocated entries in the arrays */
+static unsigned int epoll_ctl_calls;        /* epoll_ctl calls in the current loop iteration */
+
 static inline void init_epoll(void)
 {
     epoll_fd = epoll_create( 128 );
 }
 
-/* set the events that epoll waits for on this fd; helper for set_fd_events */
-static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
+/* give up on epoll and fall back to the poll loop */
+static void disable_epoll(void)
 {
-    struct epoll_event ev;
-    int ctl;
+    close( epoll_fd );
+    epoll_fd = -1;
+}
+
+/* make sure the epoll state array covers a given poll user */
+static int grow_epoll_users( int user )
+{
+    struct epoll_user *new_users;
+    int *new_dirty, i, new_count = allocated_epoll_users;
 
+    if (user < allocated_epoll_users) return 1;
+    while (new_count <= user) new_count = new_count ? new_count + new_count / 2 : 16;
+    if (!(new_users = realloc( epoll_users, new_count * sizeof(*epoll_users) ))) return 0;
+    epoll_users = new_users;
+    if (!(new_dirty = realloc( epoll_dirty, new_count * sizeof(*epoll_dirty) ))) return 0;
+    epoll_dirty = new_dirty;
+    for (i = allocated_epoll_users; i < new_count; i++)
+    {
+        epoll_users[i].fd = -1;
+        epoll_users[i].events = 0;
+        epoll_users[i].dirty = 0;
+    }
+    allocated_epoll_users = new_count;
+    return 1;
+}
+
+static inline void remove_epoll_user( struct fd *fd, int user )
+{
     if (epoll_fd == -1) return;
+    if (user >= allocated_epoll_users) return;
 
-    if (events == -1)  /* stop waiting on this fd completely */
+    /* the unix fd may be closed right away, so this can't be deferred */
+    if (epoll_users[user].fd != -1)
     {
-        if (pollfd[user].fd == -1) return;  /* already removed */
-        ctl = EPOLL_CTL_DEL;
+        struct epoll_event dummy;
+        epoll_ctl_calls++;
+        epoll_ctl( epoll_fd, EPOLL_CTL_DEL, epoll_users[user].fd, &dummy );
+        epoll_users[user].fd = -1;
     }
-    else if (pollfd[user].fd == -1)
+    /* an entry may still be on the dirty list, it will be flushed as unused */
+    epoll_users[user].events = 0;
+}
+
+/* set the events that epoll waits for on this fd; helper for set_fd_events */
+/* the change is only recorded here, it is sent to the kernel by flush_epoll_events */
+static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
+{
+    if (epoll_fd == -1) return;
+
+    if (!grow_epoll_users( user ))
     {
-        if (pollfd[user].events) return;  /* stopped waiting on it, don't restart */
-        ctl = EPOLL_CTL_ADD;
+        disable_epoll();
+        return;
     }
-    else
+    if (events == -1)  /* stop waiting on this fd completely */
     {
-        if (pollfd[user].events == events) return;  /* nothing to do */
-        ctl = EPOLL_CTL_MOD;
+        remove_epoll_user( fd, user );
+        return;
     }
+    if (epoll_users[user].dirty) return;
+    epoll_users[user].dirty = 1;
+    epoll_dirty[nb_epoll_dirty++] = user;
+}
+
+static void epoll_ctl_user( int ctl, int user, int unix_fd, int events )
+{
+    struct epoll_event ev;
 
     ev.events = events;
     memset(&ev.data, 0, sizeof(ev.data));
     ev.data.u32 = user;
 
-    if (epoll_ctl( epoll_fd, ctl, fd->unix_fd, &ev ) == -1)
+    epoll_ctl_calls++;
+    if (epoll_ctl( epoll_fd, ctl, unix_fd, &ev ) == -1)
     {
         if (errno == ENOMEM)  /* not enough memory, give up on epoll */
-        {
-            close( epoll_fd );
-            epoll_fd = -1;
-        }
-        else perror( "epoll_ctl" );  /* should not happen */
+            disable_epoll();
+        else if (ctl != EPOLL_CTL_DEL)
+            perror( "epoll_ctl" );  /* should not happen */
     }
 }
 
-static inline void remove_epoll_user( struct fd *fd, int user )
+/* send all the pending event mask changes to the kernel */
+static void flush_epoll_events(void)
 {
-    if (epoll_fd == -1) return;
+    int i;
 
-    if (pollfd[user].fd != -1)
+    for (i = 0; i < nb_epoll_dirty && epoll_fd != -1; i++)
     {
-        struct epoll_event dummy;
-        epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd->unix_fd, &dummy );
+        int user = epoll_dirty[i];
+        struct epoll_user *state = &epoll_users[user];
+
+        state->dirty = 0;
+        if (pollfd[user].fd == -1)  /* not waiting on this fd (anymore) */
+        {
+            if (state->fd == -1) continue;
+            epoll_ctl_user( EPOLL_CTL_DEL, user, state->fd, 0 );
+            state->fd = -1;
+        }
+        else if (state->fd != pollfd[user].fd)
+        {
+            if (state->fd != -1) epoll_ctl_user( EPOLL_CTL_DEL, user, state->fd, 0 );
+            state->fd = pollfd[user].fd;
+            state->events = pollfd[user].events;
+            epoll_ctl_user( EPOLL_CTL_ADD, user, state->fd, state->events );
+        }
+        else if (state->events != pollfd[user].events)
+        {
+            state->events = pollfd[user].events;
+            epoll_ctl_user( EPOLL_CTL_MOD, user, state->fd, state->events );
+        }
     }
+    nb_epoll_dirty = 0;
 }
 
 static inline void main_loop_epoll(void)
@@ -533,6 +682,8 @@ static inline void main_loop_epoll(void)
         timeout = get_next_timeout();
 
         if (!active_users) break;  /* last user removed by a timeout */
+
+        flush_epoll_events();
         if (epoll_fd == -1) break;  /* an error occurred with epoll */
 
         ret = epoll_wait( epoll_fd, events, sizeof(events)/sizeof(events[0]), timeout );
@@ -551,6 +702,15 @@ static inline void main_loop_epoll(void)
             int user = events[i].data.u32;
             if (pollfd[user].revents) fd_poll_event( poll_users[user], pollfd[user].revents );
         }
+
+        if (debug_level > 1 && ret > 0)
+        {
+            timeout_t start = current_time;
+            set_current_time();
+            fprintf( stderr, "epoll: %d events, %u ctl calls, %u us in handlers\n",
+                     ret, epoll_ctl_calls, (unsigned int)((current_time - start) / 10) );
+        }
+        epoll_ctl_calls = 0;
     }
 }
 
@@ -846,23 +1006,18 @@ static void remove_poll_user( struct fd *fd, int user )
 /* process pending timeouts and return the time until the next timeout, in milliseconds */
 static int get_next_timeout(void)
 {
-    if (!list_empty( &timeout_list ))
+    if (nb_timeouts)
     {
         struct list expired_list, *ptr;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the heap */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &timeout_list )) != NULL)
+        while (nb_timeouts && timeout_heap[0]->when <= current_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            struct timeout_user *timeout = timeout_heap[0];
+            timeout_heap_remove( 0 );
+            list_add_tail( &expired_list, &timeout->entry );
         }
 
         /* now call the callback for all the removed timers */
@@ -875,10 +1030,9 @@ static int get_next_timeout(void)
             free( timeout );
         }
 
-        if ((ptr = list_head( &timeout_list )) != NULL)
+        if (nb_timeouts)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            int diff = (timeout->when - current_time + 9999) / 10000;
+            int diff = (timeout_heap[0]->when - current_time + 9999) / 10000;
             if (diff < 0) diff = 0;
             return diff;
         }
@@ -1604,6 +1758,7 @@ static struct fd *alloc_fd_object(void)
     fd->fs_locks   = 1;
     fd->poll_index = -1;
     fd->completion = NULL;
+    fd->comp_flags = 0;
     init_async_queue( &fd->read_q );
     init_async_queue( &fd->write_q );
     init_async_queue( &fd->wait_q );
@@ -1639,6 +1794,7 @@ struct fd *alloc_pseudo_fd( const struct fd_ops *fd_user_ops, struct object *use
     fd->fs_locks   = 0;
     fd->poll_index = -1;
     fd->completion = NULL;
+    fd->comp_flags = 0;
     fd->no_fd_status = STATUS_BAD_DEVICE_TYPE;
     init_async_queue( &fd->read_q );
     init_async_queue( &fd->write_q );
@@ -2362,10 +2518,16 @@ struct completion *fd_get_completion( struct fd *fd, apc_param_t *p_key )
     return fd->completion ? (struct completion *)grab_object( fd->completion ) : NULL;
 }
 
+unsigned int fd_get_comp_flags( struct fd *fd )
+{
+    return fd->comp_flags;
+}
+
 void fd_copy_completion( struct fd *src, struct fd *dst )
 {
     assert( !dst->completion );
     dst->completion = fd_get_completion( src, &dst->comp_key );
+    dst->comp_flags = src->comp_flags;
 }
 
 /* flush a file buffers */
@@ -2456,6 +2618,7 @@ DECL_HANDLER(get_handle_fd)
     {
         int unix_fd = get_unix_fd( fd );
         reply->cacheable = fd->cacheable;
+        reply->comp_flags = fd->comp_flags;
         if (unix_fd != -1)
         {
             reply->type = fd->fd_ops->get_fd_type( fd );
@@ -2467,6 +2630,31 @@ DECL_HANDLER(get_handle_fd)
     }
 }
 
+/* send the unix fd of a newly opened handle to the client along with the reply, */
+/* so that it doesn't need a separate get_handle_fd request for the first I/O */
+int prefetch_handle_fd( struct process *process, obj_handle_t handle, struct object *obj,
+                        unsigned int *access, unsigned int *options )
+{
+    struct fd *fd;
+    int unix_fd, type = FD_TYPE_INVALID;
+
+    if (!(fd = get_obj_fd( obj )))
+    {
+        clear_error();
+        return FD_TYPE_INVALID;
+    }
+    if (fd->cacheable && (unix_fd = get_unix_fd( fd )) != -1)
+    {
+        type = fd->fd_ops->get_fd_type( fd );
+        *options = fd->options;
+        *access = get_handle_access( process, handle );
+        if (send_client_fd( process, unix_fd, handle ) == -1) type = FD_TYPE_INVALID;
+    }
+    clear_error();
+    release_object( fd );
+    return type;
+}
+
 /* perform a read on a file object */
 DECL_HANDLER(read)
 {
@@ -2550,6 +2738,24 @@ DECL_HANDLER(register_async)
     }
 }
 
+/* create an async that is only woken up by the client, on cancellation or when the fd is closed */
+DECL_HANDLER(register_client_async)
+{
+    struct async *async;
+    struct fd *fd;
+
+    if ((fd = get_handle_fd_obj( current->process, req->async.handle, req->access )))
+    {
+        if ((async = create_async( fd, current, &req->async, NULL )))
+        {
+            fd_queue_async( fd, async, ASYNC_TYPE_WAIT );
+            release_object( async );
+            set_error( STATUS_PENDING );
+        }
+        release_object( fd );
+    }
+}
+
 /* attach completion object to a fd */
 DECL_HANDLER(set_completion_info)
 {
@@ -2573,12 +2779,31 @@ DECL_HANDLER(add_fd_completion)
     struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
     if (fd)
     {
-        if (fd->completion)
+        if (fd->completion && (req->async || req->status != STATUS_SUCCESS ||
+                               !(fd->comp_flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)))
             add_completion( fd->completion, fd->comp_key, req->cvalue, req->status, req->information );
         release_object( fd );
     }
 }
 
+/* set fd completion notification flags */
+DECL_HANDLER(set_fd_completion_mode)
+{
+    struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
+    if (fd)
+    {
+        if (!(fd->options & (FILE_SYNCHRONOUS_IO_ALERT | FILE_SYNCHRONOUS_IO_NONALERT)))
+        {
+            /* flags can't be cleared once set */
+            fd->comp_flags |= req->flags & (FILE_SKIP_COMPLETION_PORT_ON_SUCCESS |
+                                            FILE_SKIP_SET_EVENT_ON_HANDLE |
+                                            FILE_SKIP_SET_USER_EVENT_ON_FAST_IO);
+        }
+        else set_error( STATUS_INVALID_PARAMETER );
+        release_object( fd );
+    }
+}
+
 /* set fd disposition information */
 DECL_HANDLER(set_fd_disp_info)
 {
@@ -729,6 +729,9 @@ DECL_HANDLER(create_file)
                              req->create, req->options, req->attrs, sd )))
     {
         reply->handle = alloc_handle( current->process, file, req->access, objattr->attributes );
+        if (reply->handle)
+            reply->type = prefetch_handle_fd( current->process, reply->handle, file,
+                                              &reply->access, &reply->options );
         release_object( file );
     }
     if (root_fd) release_object( root_fd );
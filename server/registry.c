@@ -35,6 +35,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -69,9 +72,11 @@ struct key
     struct key       *parent;      /* parent key */
     int               last_subkey; /* last in use subkey */
     int               nb_subkeys;  /* count of allocated subkeys */
+    int               sorted_subkeys; /* count of subkeys before the insertion buffer */
     struct key      **subkeys;     /* subkeys array */
     int               last_value;  /* last in use value */
     int               nb_values;   /* count of allocated values in array */
+    int               sorted_values; /* count of values before the insertion buffer */
     struct key_value *values;      /* values array */
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
@@ -85,6 +90,7 @@ struct key
 #define KEY_SYMLINK  0x0008  /* key is a symbolic link */
 #define KEY_WOW64    0x0010  /* key contains a Wow6432Node subkey */
 #define KEY_WOWSHARE 0x0020  /* key is a Wow64 shared key (used for Software\Classes) */
+#define KEY_CHANGED  0x0040  /* key itself has been modified since the last save */
 
 /* a key value */
 struct key_value
@@ -99,6 +105,17 @@ struct key_value
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
 
+/* Keys with many subkeys or values put new entries into a separate sorted
+ * insertion buffer at the end of the array, so that inserting doesn't move
+ * the whole array. The buffer is merged back into the main sorted part when
+ * it gets too large, or when entries are enumerated by index. */
+#define MIN_BUFFERED_ENTRIES 1024  /* min. number of entries to start buffering insertions */
+
+static inline int max_buffered_entries( int count )
+{
+    return max( 64, count / 256 );
+}
+
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
 
@@ -110,6 +127,7 @@ static struct key *root_key;
 
 static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
 static const timeout_t save_period = 30 * -TICKS_PER_SEC;  /* delay between periodic saves */
+static const off_t min_journal_size = 256 * 1024;  /* journal size below which we never compact */
 static struct timeout_user *save_timeout_user;  /* saving timer */
 static enum prefix_type { PREFIX_UNKNOWN, PREFIX_32BIT, PREFIX_64BIT } prefix_type;
 
@@ -121,6 +139,8 @@ static const struct unicode_str wow6432node_str = { wow6432node, sizeof(wow6432n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
+static void merge_subkeys( struct key *key );
+static void merge_values( struct key *key );
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
 
 /* information about where to save a registry branch */
@@ -128,12 +148,67 @@ struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    char        *journal;       /* path of the journal of changes since the last full save */
+    char        *hive;          /* path of the compiled hive */
+    int          hive_valid;    /* whether the compiled hive matches the text file */
+    off_t        file_size;     /* size of the branch file at the last full save */
+    off_t        journal_size;  /* current size of the journal */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
 static int save_branch_count;
 static struct save_branch_info save_branch_info[MAX_SAVE_BRANCH_INFO];
 
+/* a key deleted since the last save, to be recorded in the journal */
+struct deleted_key
+{
+    struct list                entry;   /* entry in deleted keys list */
+    struct save_branch_info   *branch;  /* branch the key belonged to */
+    data_size_t                len;     /* length of the path in bytes */
+    WCHAR                      path[1]; /* path of the key relative to the branch */
+};
+
+static struct list deleted_keys = LIST_INIT( deleted_keys );
+
+/* compiled hive file format, a binary snapshot of a branch that is much faster
+ * to load than the text file; it is only used if it matches the text file */
+
+#define HIVE_MAGIC    0x76696857  /* "Whiv" */
+#define HIVE_VERSION  1
+#define HIVE_ALIGN(len) (((len) + 7) & ~7)
+
+struct hive_header
+{
+    unsigned int magic;        /* HIVE_MAGIC */
+    unsigned int version;      /* HIVE_VERSION */
+    unsigned int prefix_type;  /* architecture of the prefix */
+    unsigned int mtime_nsec;   /* sub-second part of mtime */
+    file_pos_t   ino;          /* identity of the text file the hive was compiled from */
+    file_pos_t   size;
+    file_pos_t   mtime;
+};
+
+/* keys are stored depth-first, each one followed by its name, class, values and subkeys */
+struct hive_key
+{
+    unsigned int namelen;      /* length of the name in bytes */
+    unsigned int classlen;     /* length of the class in bytes */
+    unsigned int flags;        /* key flags (only KEY_SYMLINK is saved) */
+    unsigned int value_count;  /* number of values */
+    unsigned int subkey_count; /* number of subkeys */
+    unsigned int reserved;
+    timeout_t    modif;        /* last modification time */
+};
+
+/* each value is followed by its name and data */
+struct hive_value
+{
+    unsigned int namelen;      /* length of the name in bytes */
+    unsigned int type;         /* value type */
+    unsigned int len;          /* length of the data in bytes */
+    unsigned int reserved;
+};
+
 
 /* information about a file being loaded */
 struct file_load_info
@@ -194,6 +269,13 @@ static inline int is_wow6432node( const WCHAR *name, unsigned int len )
  * - key names use escapes too in order to support Unicode
  * - the modification time optionally follows the key name
  * - REG_EXPAND_SZ and REG_MULTI_SZ are saved as strings instead of hex
+ *
+ * Changes made between full saves are appended to a journal file using the
+ * same format, with these additions:
+ * - a "#replace" key option discards the existing values of the key
+ * - a "-[key]" line deletes the key and all its subkeys
+ * - each batch of changes is followed by a "#commit=<length>,<checksum>"
+ *   line, batches without one are incomplete and ignored on replay
  */
 
 /* dump the full path of a key */
@@ -261,32 +343,77 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* dump the name and options of a key to a text file */
+static void dump_key_header( const struct key *key, const struct key *base, FILE *f )
+{
+    fprintf( f, "\n[" );
+    if (key != base) dump_path( key, base, f );
+    fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
+    fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
+    if (key->class)
+    {
+        fprintf( f, "#class=\"" );
+        dump_strW( key->class, key->classlen / sizeof(WCHAR), f, "\"\"" );
+        fprintf( f, "\"\n" );
+    }
+    if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
+}
+
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    /* saved files are fully sorted */
+    merge_subkeys( key );
+    merge_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
     {
-        fprintf( f, "\n[" );
-        if (key != base) dump_path( key, base, f );
-        fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
-        fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
-        if (key->class)
-        {
-            fprintf( f, "#class=\"" );
-            dump_strW( key->class, key->classlen / sizeof(WCHAR), f, "\"\"" );
-            fprintf( f, "\"\n" );
-        }
-        if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
+        dump_key_header( key, base, f );
         for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
     }
     for (i = 0; i <= key->last_subkey; i++) save_subkeys( key->subkeys[i], base, f );
 }
 
+/* save the keys that changed since the last save to a journal file */
+/* only the dirty part of the tree needs to be walked */
+static void save_changed_subkeys( struct key *key, const struct key *base, FILE *f )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(key->flags & KEY_DIRTY)) return;
+    merge_subkeys( key );
+    merge_values( key );
+    if (key->flags & KEY_CHANGED)
+    {
+        dump_key_header( key, base, f );
+        fputs( "#replace\n", f );
+        for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
+    }
+    for (i = 0; i <= key->last_subkey; i++) save_changed_subkeys( key->subkeys[i], base, f );
+}
+
+/* dump the path of a deleted key to a journal file */
+static void dump_deleted_key( const struct deleted_key *deleted, FILE *f )
+{
+    const WCHAR *p = deleted->path, *end = deleted->path + deleted->len / sizeof(WCHAR), *next;
+
+    fprintf( f, "\n-[" );
+    for (;;)
+    {
+        for (next = p; next < end && *next != '\\'; next++) ;
+        dump_strW( p, next - p, f, "[]" );
+        if (next == end) break;
+        fprintf( f, "\\\\" );
+        p = next + 1;
+    }
+    fprintf( f, "]\n" );
+}
+
 static void dump_operation( const struct key *key, const struct key_value *value, const char *op )
 {
     fprintf( stderr, "%s key ", op );
@@ -314,30 +441,88 @@ static struct object_type *key_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
-/* find the named child of a given key and return its index */
-static struct key *find_subkey( const struct key *key, const WCHAR *name, int namelen, int *index )
+/* compare the name of a subkey with a given name */
+static inline int compare_subkey( const struct key *subkey, const WCHAR *name, int namelen )
 {
-    int i, min, max, res;
-    data_size_t len;
+    data_size_t len = min( subkey->obj.name->len, namelen );
+    int res = memicmpW( subkey->obj.name->name, name, len / sizeof(WCHAR) );
+
+    if (!res) res = subkey->obj.name->len - namelen;
+    return res;
+}
+
+/* binary search a name in the sorted range [min,max] of the subkeys array */
+/* return the index where it was found, or where it should be inserted */
+static int search_subkeys( const struct key *key, int min, int max, const WCHAR *name, int namelen, int *found )
+{
+    int i, res;
 
-    min = 0;
-    max = key->last_subkey;
     while (min <= max)
     {
         i = (min + max) / 2;
-        len = min( key->subkeys[i]->obj.name->len, namelen );
-        res = memicmpW( key->subkeys[i]->obj.name->name, name, len / sizeof(WCHAR) );
-        if (!res) res = key->subkeys[i]->obj.name->len - namelen;
-        if (!res)
+        if (!(res = compare_subkey( key->subkeys[i], name, namelen )))
         {
-            if (index) *index = i;
-            return (struct key *)grab_object( key->subkeys[i] );
+            *found = 1;
+            return i;
         }
         if (res > 0) max = i - 1;
         else min = i + 1;
     }
-    if (index) *index = min;  /* this is where we should insert it */
-    return NULL;
+    *found = 0;
+    return min;
+}
+
+/* find the named child of a given key and return its index */
+static struct key *find_subkey( const struct key *key, const WCHAR *name, int namelen, int *index )
+{
+    int i, found;
+
+    /* look in the main sorted part first, then in the insertion buffer */
+    i = search_subkeys( key, 0, key->sorted_subkeys - 1, name, namelen, &found );
+    if (!found) i = search_subkeys( key, key->sorted_subkeys, key->last_subkey, name, namelen, &found );
+    if (!found) return NULL;
+    if (index) *index = i;
+    return (struct key *)grab_object( key->subkeys[i] );
+}
+
+/* merge the insertion buffer of the subkeys array back into the main sorted part */
+static void merge_subkeys( struct key *key )
+{
+    int i, j, k, found, count = key->last_subkey + 1;
+    struct key **buffer, *subkey;
+
+    if (key->sorted_subkeys == count) return;
+
+    if (!(buffer = memdup( key->subkeys + key->sorted_subkeys,
+                           (count - key->sorted_subkeys) * sizeof(*buffer) )))
+    {
+        /* no memory for a proper merge, move the entries one at a time */
+        clear_error();
+        while (key->sorted_subkeys < count)
+        {
+            subkey = key->subkeys[key->sorted_subkeys];
+            i = search_subkeys( key, 0, key->sorted_subkeys - 1, subkey->obj.name->name,
+                                subkey->obj.name->len, &found );
+            memmove( key->subkeys + i + 1, key->subkeys + i, (key->sorted_subkeys - i) * sizeof(*buffer) );
+            key->subkeys[i] = subkey;
+            key->sorted_subkeys++;
+        }
+        return;
+    }
+
+    /* merge from the end, so that the main part is never overwritten before being moved */
+    i = key->sorted_subkeys - 1;
+    j = count - key->sorted_subkeys - 1;
+    k = count - 1;
+    while (j >= 0)
+    {
+        if (i >= 0 && compare_subkey( key->subkeys[i], buffer[j]->obj.name->name, buffer[j]->obj.name->len ) > 0)
+            key->subkeys[k--] = key->subkeys[i--];
+        else
+            key->subkeys[k--] = buffer[j--];
+    }
+    free( buffer );
+    key->sorted_subkeys = count;
 }
 
 /* try to grow the array of subkeys; return 1 if OK, 0 on error */
@@ -376,6 +561,14 @@ static void make_dirty( struct key *key )
     }
 }
 
+/* mark a key as modified itself, so that it gets written to the journal */
+static void make_changed( struct key *key )
+{
+    if (key->flags & KEY_VOLATILE) return;
+    key->flags |= KEY_CHANGED;
+    make_dirty( key );
+}
+
 /* notify waiter and maybe delete the notification */
 static void do_notification( struct key *key, struct notify *notify, int del )
 {
@@ -411,7 +604,7 @@ static void touch_key( struct key *key, unsigned int change )
     struct key *k;
 
     key->modif = current_time;
-    make_dirty( key );
+    make_changed( key );
 
     /* do notifications */
     check_notify( key, change, 1 );
@@ -425,7 +618,7 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     struct key *key = (struct key *)obj;
     struct key *key_parent = (struct key *)parent;
     struct object *root_directory = get_root_directory();
-    int index, i;
+    int index, found, i;
 
     /* are we creating the root key? */
     if (parent == root_directory && !strncmpiW( registryW, name->name, name->len/sizeof(WCHAR) ))
@@ -448,8 +641,18 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
         /* need to grow the array */
         if (!grow_subkeys( key_parent )) return 0;
     }
-    /* find the sorted index */
-    assert( !find_subkey( key_parent, name->name, name->len, &index ) );
+    assert( !find_subkey( key_parent, name->name, name->len, NULL ) );
+    if (key_parent->last_subkey + 1 - key_parent->sorted_subkeys >=
+        max_buffered_entries( key_parent->last_subkey + 1 ))
+        merge_subkeys( key_parent );
+
+    /* find the sorted index, in the insertion buffer unless appending to the main part is cheap */
+    index = search_subkeys( key_parent, 0, key_parent->sorted_subkeys - 1, name->name, name->len, &found );
+    if (index < key_parent->sorted_subkeys && key_parent->last_subkey + 1 >= MIN_BUFFERED_ENTRIES)
+        index = search_subkeys( key_parent, key_parent->sorted_subkeys, key_parent->last_subkey,
+                                name->name, name->len, &found );
+    else
+        key_parent->sorted_subkeys++;
     for (i = ++key_parent->last_subkey; i > index; i--)
         key_parent->subkeys[i] = key_parent->subkeys[i-1];
     key_parent->subkeys[index] = key;
@@ -732,6 +935,7 @@ static void free_subkey( struct key *key )
     for (i = 0; i <= parent->last_subkey; i++)
         if (parent->subkeys[i] == key) break;
     assert( i <= parent->last_subkey );
+    if (i < parent->sorted_subkeys) parent->sorted_subkeys--;
 
     for (; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
     parent->last_subkey--;
@@ -780,6 +984,62 @@ static int delete_key( struct key *key, int recurse )
     return 0;
 }
 
+/* find the saved branch containing a given key */
+static struct save_branch_info *get_key_branch( const struct key *key )
+{
+    int i;
+
+    for ( ; key; key = key->parent)
+        for (i = 0; i < save_branch_count; i++)
+            if (save_branch_info[i].key == key) return &save_branch_info[i];
+    return NULL;
+}
+
+/* delete a key on behalf of a client, remembering it for the next journal save */
+static void delete_saved_key( struct key *key, int recurse )
+{
+    struct save_branch_info *branch = NULL;
+    struct deleted_key *deleted = NULL;
+    const struct key *k;
+    data_size_t len = 0;
+    WCHAR *p;
+
+    /* the path has to be built now since the key is unlinked from the tree by the deletion */
+    if (!(key->flags & KEY_VOLATILE) && (branch = get_key_branch( key )) && branch->key != key)
+    {
+        for (k = key; k != branch->key; k = k->parent) len += k->obj.name->len + sizeof(WCHAR);
+        len -= sizeof(WCHAR);
+        if ((deleted = mem_alloc( offsetof( struct deleted_key, path[len / sizeof(WCHAR)] ))))
+        {
+            deleted->branch = branch;
+            deleted->len = len;
+            p = deleted->path + len / sizeof(WCHAR);
+            for (k = key; k != branch->key; k = k->parent)
+            {
+                p -= k->obj.name->len / sizeof(WCHAR);
+                memcpy( p, k->obj.name->name, k->obj.name->len );
+                if (k->parent != branch->key) *--p = '\\';
+            }
+        }
+    }
+
+    if (!delete_key( key, recurse ) && deleted) list_add_tail( &deleted_keys, &deleted->entry );
+    else free( deleted );
+}
+
+/* forget the deleted keys of a branch once they have been saved */
+static void free_deleted_keys( struct save_branch_info *branch )
+{
+    struct deleted_key *deleted, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( deleted, next, &deleted_keys, struct deleted_key, entry )
+    {
+        if (deleted->branch != branch) continue;
+        list_remove( &deleted->entry );
+        free( deleted );
+    }
+}
+
 static void key_destroy( struct object *obj )
 {
     int i;
@@ -815,7 +1075,7 @@ static void make_clean( struct key *key )
 
     if (key->flags & KEY_VOLATILE) return;
     if (!(key->flags & KEY_DIRTY)) return;
-    key->flags &= ~KEY_DIRTY;
+    key->flags &= ~(KEY_DIRTY | KEY_CHANGED);
     for (i = 0; i <= key->last_subkey; i++) make_clean( key->subkeys[i] );
 }
 
@@ -854,13 +1114,15 @@ static struct key *create_key( struct object *parent, const struct unicode_str *
                 key->class = NULL;
                 key->classlen = 0;
             }
-            key->flags       = options & REG_OPTION_VOLATILE ? KEY_VOLATILE : KEY_DIRTY;
+            key->flags       = options & REG_OPTION_VOLATILE ? KEY_VOLATILE : KEY_DIRTY | KEY_CHANGED;
             if (options & REG_OPTION_CREATE_LINK) key->flags |= KEY_SYMLINK;
             key->last_subkey = -1;
             key->nb_subkeys  = 0;
+            key->sorted_subkeys = 0;
             key->subkeys     = NULL;
             key->nb_values   = 0;
             key->last_value  = -1;
+            key->sorted_values = 0;
             key->values      = NULL;
             key->modif       = current_time;
             list_init( &key->notify_list );
@@ -903,7 +1165,7 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
 }
 
 /* query information about a key or a subkey */
-static void enum_key( const struct key *key, int index, int info_class,
+static void enum_key( struct key *key, int index, int info_class,
                       struct enum_key_reply *reply )
 {
     static const WCHAR backslash[] = { '\\' };
@@ -921,6 +1183,7 @@ static void enum_key( const struct key *key, int index, int info_class,
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
+        merge_subkeys( key );
         key = key->subkeys[index];
     }
 
@@ -1033,38 +1296,98 @@ static int grow_values( struct key *key )
     return 1;
 }
 
-/* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+/* compare the name of a value with a given name */
+static inline int compare_value( const struct key_value *value, const WCHAR *name, data_size_t namelen )
 {
-    int i, min, max, res;
-    data_size_t len;
+    data_size_t len = min( value->namelen, namelen );
+    int res = memicmpW( value->name, name, len / sizeof(WCHAR) );
+
+    if (!res) res = value->namelen - namelen;
+    return res;
+}
+
+/* binary search a name in the sorted range [min,max] of the values array */
+/* return the index where it was found, or where it should be inserted */
+static int search_values( const struct key *key, int min, int max, const struct unicode_str *name, int *found )
+{
+    int i, res;
 
-    min = 0;
-    max = key->last_value;
     while (min <= max)
     {
         i = (min + max) / 2;
-        len = min( key->values[i].namelen, name->len );
-        res = memicmpW( key->values[i].name, name->str, len / sizeof(WCHAR) );
-        if (!res) res = key->values[i].namelen - name->len;
-        if (!res)
+        if (!(res = compare_value( &key->values[i], name->str, name->len )))
         {
-            *index = i;
-            return &key->values[i];
+            *found = 1;
+            return i;
         }
         if (res > 0) max = i - 1;
         else min = i + 1;
     }
-    *index = min;  /* this is where we should insert it */
-    return NULL;
+    *found = 0;
+    return min;
+}
+
+/* find the named value of a given key and return its index in the array */
+static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+{
+    int i, found;
+
+    /* look in the main sorted part first, then in the insertion buffer */
+    i = search_values( key, 0, key->sorted_values - 1, name, &found );
+    if (!found) i = search_values( key, key->sorted_values, key->last_value, name, &found );
+    if (!found) return NULL;
+    *index = i;
+    return &key->values[i];
+}
+
+/* merge the insertion buffer of the values array back into the main sorted part */
+static void merge_values( struct key *key )
+{
+    int i, j, k, found, count = key->last_value + 1;
+    struct key_value *buffer, value;
+    struct unicode_str name;
+
+    if (key->sorted_values == count) return;
+
+    if (!(buffer = memdup( key->values + key->sorted_values,
+                           (count - key->sorted_values) * sizeof(*buffer) )))
+    {
+        /* no memory for a proper merge, move the entries one at a time */
+        clear_error();
+        while (key->sorted_values < count)
+        {
+            value = key->values[key->sorted_values];
+            name.str = value.name;
+            name.len = value.namelen;
+            i = search_values( key, 0, key->sorted_values - 1, &name, &found );
+            memmove( key->values + i + 1, key->values + i, (key->sorted_values - i) * sizeof(value) );
+            key->values[i] = value;
+            key->sorted_values++;
+        }
+        return;
+    }
+
+    /* merge from the end, so that the main part is never overwritten before being moved */
+    i = key->sorted_values - 1;
+    j = count - key->sorted_values - 1;
+    k = count - 1;
+    while (j >= 0)
+    {
+        if (i >= 0 && compare_value( &key->values[i], buffer[j].name, buffer[j].namelen ) > 0)
+            key->values[k--] = key->values[i--];
+        else
+            key->values[k--] = buffer[j--];
+    }
+    free( buffer );
+    key->sorted_values = count;
 }
 
-/* insert a new value; the index must have been returned by find_value */
-static struct key_value *insert_value( struct key *key, const struct unicode_str *name, int index )
+/* insert a new value, which must not exist already */
+static struct key_value *insert_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
     WCHAR *new_name = NULL;
-    int i;
+    int i, index, found;
 
     if (name->len > MAX_VALUE_LEN * sizeof(WCHAR))
     {
@@ -1076,6 +1399,15 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
         if (!grow_values( key )) return NULL;
     }
     if (name->len && !(new_name = memdup( name->str, name->len ))) return NULL;
+    if (key->last_value + 1 - key->sorted_values >= max_buffered_entries( key->last_value + 1 ))
+        merge_values( key );
+
+    /* find the sorted index, in the insertion buffer unless appending to the main part is cheap */
+    index = search_values( key, 0, key->sorted_values - 1, name, &found );
+    if (index < key->sorted_values && key->last_value + 1 >= MIN_BUFFERED_ENTRIES)
+        index = search_values( key, key->sorted_values, key->last_value, name, &found );
+    else
+        key->sorted_values++;
     for (i = ++key->last_value; i > index; i--) key->values[i] = key->values[i - 1];
     value = &key->values[index];
     value->name    = new_name;
@@ -1118,7 +1450,7 @@ static void set_value( struct key *key, const struct unicode_str *name,
 
     if (!value)
     {
-        if (!(value = insert_value( key, name, index )))
+        if (!(value = insert_value( key, name )))
         {
             free( ptr );
             return;
@@ -1164,6 +1496,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
         void *data;
         data_size_t namelen, maxlen;
 
+        merge_values( key );
         value = &key->values[i];
         reply->type = value->type;
         namelen = value->namelen;
@@ -1220,6 +1553,7 @@ static void delete_value( struct key *key, const struct unicode_str *name )
     free( value->data );
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
+    if (index < key->sorted_values) key->sorted_values--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
     /* try to shrink the array */
@@ -1380,6 +1714,39 @@ static struct key *load_key( struct key *base, const char *buffer, int prefix_le
     return create_key_recursive( base, &name, 0 );
 }
 
+/* delete a key listed in a journal file */
+static void load_deleted_key( struct key *base, const char *buffer, struct file_load_info *info )
+{
+    struct unicode_str name, token;
+    struct key *key, *subkey;
+    data_size_t len;
+
+    if (!get_file_tmp_space( info, strlen(buffer) * sizeof(WCHAR) )) return;
+
+    len = info->tmplen;
+    if (parse_strW( info->tmp, &len, buffer, ']' ) == -1)
+    {
+        file_read_error( "Malformed key", info );
+        return;
+    }
+    name.str = info->tmp;
+    name.len = len - sizeof(WCHAR);
+    token.str = NULL;
+    if (!get_path_token( &name, &token ) || !token.len) return;
+
+    /* don't create anything, the key may well not exist anymore */
+    key = (struct key *)grab_object( base );
+    while (token.len)
+    {
+        subkey = find_subkey( key, token.str, token.len, NULL );
+        release_object( key );
+        if (!(key = subkey)) return;
+        get_path_token( &name, &token );
+    }
+    delete_key( key, 1 );
+    release_object( key );
+}
+
 /* update the modification time of a key (and its parents) after it has been loaded from a file */
 static void update_key_time( struct key *key, timeout_t modif )
 {
@@ -1449,6 +1816,17 @@ static int load_key_option( struct key *key, const char *buffer, struct file_loa
         key->classlen = len;
     }
     if (!strncmp( buffer, "#link", 5 )) key->flags |= KEY_SYMLINK;
+    if (!strcmp( buffer, "#replace" ))
+    {
+        int i;
+        for (i = 0; i <= key->last_value; i++)
+        {
+            free( key->values[i].name );
+            free( key->values[i].data );
+        }
+        key->last_value = -1;
+        key->sorted_values = 0;
+    }
     /* ignore unknown options */
     return 1;
 }
@@ -1502,7 +1880,7 @@ static struct key_value *parse_value_name( struct key *key, const char *buffer,
     if (buffer[*len] != '=') goto error;
     (*len)++;
     while (isspace(buffer[*len])) (*len)++;
-    if (!(value = find_value( key, &name, &index ))) value = insert_value( key, &name, index );
+    if (!(value = find_value( key, &name, &index ))) value = insert_value( key, &name );
     return value;
 
  error:
@@ -1648,6 +2026,17 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
             if (prefix_len == -1) prefix_len = get_prefix_len( key, p + 1, &info );
             if (!(subkey = load_key( key, p + 1, prefix_len, &info, &modif )))
                 file_read_error( "Error creating key", &info );
+            else make_changed( subkey );
+            break;
+        case '-':   /* deleted key */
+            if (subkey)
+            {
+                update_key_time( subkey, modif );
+                release_object( subkey );
+                subkey = NULL;
+            }
+            if (p[1] == '[') load_deleted_key( key, p + 2, &info );
+            else file_read_error( "Unrecognized input", &info );
             break;
         case '@':   /* default value */
         case '\"':  /* value */
@@ -1698,28 +2087,284 @@ static void load_registry( struct key *key, obj_handle_t handle )
     }
 }
 
+/* compute the checksum of a batch of journal changes (32-bit FNV-1a) */
+static unsigned int get_journal_checksum( const char *data, size_t len )
+{
+    unsigned int sum = 0x811c9dc5;
+
+    while (len--) sum = (sum ^ (unsigned char)*data++) * 0x01000193;
+    return sum;
+}
+
+/* return the size of the part of a journal made of the header and complete batches */
+static size_t get_journal_committed_size( const char *data, size_t size )
+{
+    const char *p = data, *end = data + size, *batch, *committed, *eol;
+    unsigned long len;
+    unsigned int sum;
+    int i;
+
+    for (i = 0; i < 3; i++)  /* header lines */
+    {
+        if (!(eol = memchr( p, '\n', end - p ))) return 0;
+        p = eol + 1;
+    }
+    batch = committed = p;
+    while ((eol = memchr( p, '\n', end - p )))
+    {
+        if (!strncmp( p, "#commit=", 8 ))
+        {
+            if (sscanf( p + 8, "%lx,%x", &len, &sum ) != 2 || len != p - batch ||
+                sum != get_journal_checksum( batch, len ))
+                break;
+            batch = committed = eol + 1;
+        }
+        p = eol + 1;
+    }
+    return committed - data;
+}
+
+/* nanoseconds part of the modification time, files can be rewritten within the same second */
+static unsigned int get_mtime_nsec( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/* format the stamp identifying the branch file a journal applies to */
+static int get_journal_base( const char *path, char *buffer )
+{
+    struct stat st;
+
+    if (stat( path, &st ) == -1) return 0;
+    sprintf( buffer, "#base=%lx,%lx,%lx,%x\n", (unsigned long)st.st_ino,
+             (unsigned long)st.st_size, (unsigned long)st.st_mtime, get_mtime_nsec( &st ) );
+    return 1;
+}
+
+/* replay the journal of changes made to a branch since its last full save */
+static void load_init_registry_journal( struct save_branch_info *info )
+{
+    char base[80], buffer[80], *data;
+    size_t size, committed;
+    struct stat st;
+    FILE *f, *tmp;
+
+    if (!(f = fopen( info->journal, "r" ))) return;
+
+    /* a journal only applies to the exact file it was written against */
+    if (!get_journal_base( info->path, base ) ||
+        !fgets( buffer, sizeof(buffer), f ) || !fgets( buffer, sizeof(buffer), f ) ||
+        strcmp( buffer, base ))
+    {
+        fprintf( stderr, "wineserver: ignoring stale registry journal %s\n", info->journal );
+        fclose( f );
+        unlink( info->journal );
+        return;
+    }
+
+    /* only replay complete batches, a crash may have left a partial one at the end */
+    if (fstat( fileno( f ), &st ) == -1 || !(data = malloc( st.st_size + 1 )))
+    {
+        fclose( f );
+        return;
+    }
+    rewind( f );
+    size = fread( data, 1, st.st_size, f );
+    data[size] = 0;
+    if (!(committed = get_journal_committed_size( data, size )))
+    {
+        fprintf( stderr, "wineserver: ignoring truncated registry journal %s\n", info->journal );
+        free( data );
+        fclose( f );
+        unlink( info->journal );
+        return;
+    }
+    if (committed < size)
+    {
+        fprintf( stderr, "wineserver: discarding incomplete changes at the end of registry journal %s\n",
+                 info->journal );
+        /* reopen it rather than rewind, stdio may still have the discarded part buffered */
+        if (!truncate( info->journal, committed )) f = freopen( info->journal, "r", f );
+        else
+        {
+            /* load from a copy, the size mismatch makes the next save a full one */
+            if ((tmp = tmpfile())) fwrite( data, 1, committed, tmp );
+            fclose( f );
+            f = tmp;
+        }
+    }
+    free( data );
+    if (!f) return;
+
+    rewind( f );
+    load_keys( info->key, info->journal, f, 0 );
+    info->journal_size = committed;
+    fclose( f );
+}
+
+/* load a key and its subkeys from a compiled hive */
+/* if create is set, the key is created as a subkey of the specified key */
+static const char *load_hive_key( struct key *key, int create, const char *ptr, const char *end )
+{
+    const struct hive_key *hk = (const struct hive_key *)ptr;
+    const struct hive_value *hv;
+    struct key_value *value;
+    struct unicode_str name;
+    unsigned int i;
+    int index;
+
+    if (end - ptr < sizeof(*hk)) return NULL;
+    ptr += sizeof(*hk);
+    if (hk->namelen > 0xffff || hk->classlen > 0xffff ||
+        end - ptr < HIVE_ALIGN(hk->namelen) + HIVE_ALIGN(hk->classlen)) return NULL;
+
+    if (create)
+    {
+        name.str = (const WCHAR *)ptr;
+        name.len = hk->namelen;
+        if (!name.len || !(key = create_key( &key->obj, &name, NULL, 0, 0, OBJ_OPENIF, NULL ))) return NULL;
+    }
+    ptr += HIVE_ALIGN(hk->namelen);
+
+    if (hk->classlen)
+    {
+        free( key->class );
+        if (!(key->class = memdup( ptr, hk->classlen ))) key->classlen = 0;
+        else key->classlen = hk->classlen;
+    }
+    ptr += HIVE_ALIGN(hk->classlen);
+    key->flags |= hk->flags & KEY_SYMLINK;
+    key->modif = hk->modif;
+
+    for (i = 0; i < hk->value_count; i++)
+    {
+        hv = (const struct hive_value *)ptr;
+        if (end - ptr < sizeof(*hv)) goto error;
+        ptr += sizeof(*hv);
+        if (hv->namelen > 0xffff || hv->len > end - ptr ||
+            end - ptr < HIVE_ALIGN(hv->namelen) + HIVE_ALIGN(hv->len)) goto error;
+        name.str = (const WCHAR *)ptr;
+        name.len = hv->namelen;
+        ptr += HIVE_ALIGN(hv->namelen);
+        if (!(value = find_value( key, &name, &index )) && !(value = insert_value( key, &name )))
+            goto error;
+        free( value->data );
+        value->data = hv->len ? memdup( ptr, hv->len ) : NULL;
+        value->len  = value->data ? hv->len : 0;
+        value->type = hv->type;
+        ptr += HIVE_ALIGN(hv->len);
+    }
+
+    for (i = 0; ptr && i < hk->subkey_count; i++) ptr = load_hive_key( key, 1, ptr, end );
+
+    if (create) release_object( key );
+    return ptr;
+
+error:
+    if (create) release_object( key );
+    return NULL;
+}
+
+/* load a branch from its compiled hive if it is up to date with the text file */
+static int load_init_registry_hive( struct save_branch_info *info )
+{
+    const struct hive_header *header;
+    struct stat st, st_hive;
+    void *base;
+    int fd, ret = 0;
+
+    if (!info->hive || stat( info->path, &st ) == -1) return 0;
+    if ((fd = open( info->hive, O_RDONLY )) == -1) return 0;
+    if (fstat( fd, &st_hive ) == -1 || st_hive.st_size < sizeof(*header) ||
+        (base = mmap( NULL, st_hive.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return 0;
+    }
+    close( fd );
+
+    header = base;
+    if (header->magic == HIVE_MAGIC && header->version == HIVE_VERSION &&
+        header->ino == st.st_ino && header->size == st.st_size && header->mtime == st.st_mtime &&
+        header->mtime_nsec == get_mtime_nsec( &st ) &&
+        (prefix_type == PREFIX_UNKNOWN || prefix_type == header->prefix_type))
+    {
+        const char *end = (const char *)base + st_hive.st_size;
+
+        if (load_hive_key( info->key, 0, (const char *)(header + 1), end ) == end)
+        {
+            prefix_type = header->prefix_type;
+            ret = 1;
+        }
+        else fprintf( stderr, "wineserver: %s is corrupted, loading %s instead\n", info->hive, info->path );
+    }
+    munmap( base, st_hive.st_size );
+    return ret;
+}
+
+/* build the name of a file associated with a registry branch */
+static char *get_branch_file_name( const char *filename, const char *ext )
+{
+    char *ret;
+
+    if ((ret = malloc( strlen(filename) + strlen(ext) + 1 )))
+    {
+        strcpy( ret, filename );
+        strcat( ret, ext );
+    }
+    return ret;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
+    struct save_branch_info *info;
+    struct stat st;
+    int loaded;
     FILE *f;
 
-    if ((f = fopen( filename, "r" )))
+    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
+
+    info = &save_branch_info[save_branch_count];
+    info->path = filename;
+    info->key = key;
+    info->journal = get_branch_file_name( filename, ".journal" );
+    info->hive = get_branch_file_name( filename, ".hive" );
+    info->journal_size = 0;
+    info->hive_valid = 0;
+
+    if ((loaded = load_init_registry_hive( info ))) info->hive_valid = 1;
+    else if ((f = fopen( filename, "r" )))
     {
         load_keys( key, filename, f, 0 );
         fclose( f );
+        loaded = 1;
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
             fprintf( stderr, "%s is not a valid registry file\n", filename );
+            free( info->journal );
+            free( info->hive );
             return 1;
         }
     }
 
-    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
-
-    save_branch_info[save_branch_count].path = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    save_branch_count++;
+    grab_object( key );
+    info->file_size = stat( filename, &st ) ? 0 : st.st_size;
+    if (loaded)
+    {
+        if (info->journal) load_init_registry_journal( info );
+        /* everything loaded so far is already on disk */
+        make_clean( key );
+    }
     make_object_static( &key->obj );
-    return (f != NULL);
+    return loaded;
 }
 
 static WCHAR *format_user_registry_path( const SID *sid, struct unicode_str *path )
@@ -1939,15 +2584,103 @@ static void save_registry( struct key *key, obj_handle_t handle )
     }
 }
 
+/* save a key and its subkeys to a compiled hive */
+static void save_hive_key( struct key *key, FILE *f )
+{
+    static const char padding[8];
+    struct hive_key hk;
+    struct hive_value hv;
+    int i;
+
+    merge_subkeys( key );
+    merge_values( key );
+
+    memset( &hk, 0, sizeof(hk) );
+    hk.namelen = key->obj.name ? key->obj.name->len : 0;
+    hk.classlen = key->classlen;
+    hk.flags = key->flags & KEY_SYMLINK;
+    hk.value_count = key->last_value + 1;
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!(key->subkeys[i]->flags & KEY_VOLATILE)) hk.subkey_count++;
+    hk.modif = key->modif;
+
+    fwrite( &hk, sizeof(hk), 1, f );
+    if (hk.namelen) fwrite( key->obj.name->name, hk.namelen, 1, f );
+    fwrite( padding, HIVE_ALIGN(hk.namelen) - hk.namelen, 1, f );
+    if (hk.classlen) fwrite( key->class, hk.classlen, 1, f );
+    fwrite( padding, HIVE_ALIGN(hk.classlen) - hk.classlen, 1, f );
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        const struct key_value *value = &key->values[i];
+
+        memset( &hv, 0, sizeof(hv) );
+        hv.namelen = value->namelen;
+        hv.type = value->type;
+        hv.len = value->len;
+        fwrite( &hv, sizeof(hv), 1, f );
+        if (hv.namelen) fwrite( value->name, hv.namelen, 1, f );
+        fwrite( padding, HIVE_ALIGN(hv.namelen) - hv.namelen, 1, f );
+        if (hv.len) fwrite( value->data, hv.len, 1, f );
+        fwrite( padding, HIVE_ALIGN(hv.len) - hv.len, 1, f );
+    }
+
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!(key->subkeys[i]->flags & KEY_VOLATILE)) save_hive_key( key->subkeys[i], f );
+}
+
+/* compile a registry branch that has just been saved into a hive */
+static void save_branch_hive( struct save_branch_info *info )
+{
+    struct hive_header header;
+    struct stat st;
+    char *tmp;
+    int fd, ret = 0;
+    FILE *f;
+
+    if (!info->hive) return;
+    info->hive_valid = 0;
+    unlink( info->hive );
+    if (stat( info->path, &st ) == -1 || !S_ISREG(st.st_mode)) return;
+    if (!(tmp = get_branch_file_name( info->hive, ".tmp" ))) return;
+    if ((fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666 )) == -1) goto done;
+    if (!(f = fdopen( fd, "w" )))
+    {
+        close( fd );
+        goto done;
+    }
+
+    memset( &header, 0, sizeof(header) );
+    header.magic = HIVE_MAGIC;
+    header.version = HIVE_VERSION;
+    header.prefix_type = prefix_type;
+    header.ino = st.st_ino;
+    header.size = st.st_size;
+    header.mtime = st.st_mtime;
+    header.mtime_nsec = get_mtime_nsec( &st );
+    fwrite( &header, sizeof(header), 1, f );
+    save_hive_key( info->key, f );
+    ret = !ferror( f );
+    if (fclose( f )) ret = 0;
+    if (ret) ret = !rename( tmp, info->hive );
+    info->hive_valid = ret;
+
+done:
+    if (!ret) unlink( tmp );
+    free( tmp );
+}
+
 /* save a registry branch to a file */
-static int save_branch( struct key *key, const char *path )
+static int save_branch( struct save_branch_info *info )
 {
+    struct key *key = info->key;
+    const char *path = info->path;
     struct stat st;
     char *p, *tmp = NULL;
     int fd, count = 0, ret = 0;
     FILE *f;
 
-    if (!(key->flags & KEY_DIRTY))
+    if (!(key->flags & KEY_DIRTY) && !info->journal_size)
     {
         if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
         return 1;
@@ -2009,19 +2742,110 @@ static int save_branch( struct key *key, const char *path )
 
 done:
     free( tmp );
-    if (ret) make_clean( key );
+    if (ret)
+    {
+        save_branch_hive( info );
+        make_clean( key );
+        free_deleted_keys( info );
+        /* the journal is now obsolete */
+        if (info->journal) unlink( info->journal );
+        info->journal_size = 0;
+        info->file_size = stat( path, &st ) ? 0 : st.st_size;
+    }
+    return ret;
+}
+
+/* append the changes made to a registry branch since the last save to its journal */
+static int save_branch_journal( struct save_branch_info *info )
+{
+    struct deleted_key *deleted;
+    char base[80], *data;
+    struct stat st;
+    off_t start;
+    size_t len;
+    int fd, written = 0, ret = 0;
+    FILE *f;
+
+    if (!info->journal) return 0;
+    if (!info->journal_size && !get_journal_base( info->path, base )) return 0;
+    if ((fd = open( info->journal, O_RDWR | O_APPEND | O_CREAT, 0666 )) == -1) return 0;
+    if (!(f = fdopen( fd, "a" )))
+    {
+        close( fd );
+        return 0;
+    }
+
+    if (debug_level > 1)
+    {
+        fprintf( stderr, "%s: ", info->journal );
+        dump_operation( info->key, NULL, "journaling" );
+    }
+
+    if (!info->journal_size)
+    {
+        /* start a new journal, discarding any leftover from a failed save */
+        if (ftruncate( fd, 0 ) == -1) goto done;
+        fprintf( f, "WINE REGISTRY Version 2\n%s;; Changes to %s since it was last saved\n",
+                 base, info->path );
+    }
+    /* if the journal doesn't end with our last batch, save the branch in full instead */
+    else if (fstat( fd, &st ) == -1 || st.st_size != info->journal_size) goto done;
+
+    written = 1;
+    if (fflush( f ) || fstat( fd, &st ) == -1) goto done;
+    start = st.st_size;
+
+    LIST_FOR_EACH_ENTRY( deleted, &deleted_keys, struct deleted_key, entry )
+        if (deleted->branch == info) dump_deleted_key( deleted, f );
+    save_changed_subkeys( info->key, info->key, f );
+    if (fflush( f ) || fstat( fd, &st ) == -1) goto done;
+
+    /* seal the batch so that a partially written one can be recognized */
+    len = st.st_size - start;
+    if (!(data = malloc( len + 1 ))) goto done;
+    if (pread( fd, data, len, start ) == len)
+        ret = fprintf( f, "#commit=%lx,%08x\n", (unsigned long)len, get_journal_checksum( data, len )) > 0;
+    free( data );
+
+    /* make sure the changes are on disk before forgetting about them */
+    if (ret) ret = !fflush( f ) && !fsync( fd ) && !fstat( fd, &st );
+
+done:
+    if (fclose( f )) ret = 0;
+    if (ret)
+    {
+        info->journal_size = st.st_size;
+        make_clean( info->key );
+        free_deleted_keys( info );
+    }
+    else if (written)
+    {
+        /* drop the partial batch; if that fails, the size check above forces a full save next time */
+        if (!info->journal_size) unlink( info->journal );
+        else if (truncate( info->journal, info->journal_size ) == -1)
+            fprintf( stderr, "wineserver: could not truncate registry journal %s\n", info->journal );
+    }
     return ret;
 }
 
 /* periodic saving of the registry */
+/* small changes are appended to a journal, the branch file is rewritten once the journal grows too large */
 static void periodic_save( void *arg )
 {
+    struct save_branch_info *info;
     int i;
 
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+    {
+        info = &save_branch_info[i];
+        if (!(info->key->flags & KEY_DIRTY)) continue;
+        if (info->file_size && info->journal_size < max( info->file_size / 2, min_journal_size ) &&
+            save_branch_journal( info ))
+            continue;
+        save_branch( info );
+    }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2034,6 +2858,7 @@ static void set_periodic_save_timer(void)
 }
 
 /* save the modified registry branches to disk */
+/* branches are always saved in full here, so that no journal is left behind on a clean exit */
 void flush_registry(void)
 {
     int i;
@@ -2041,12 +2866,13 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        if (!save_branch( &save_branch_info[i] ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].path );
             perror( " " );
         }
+        else if (!save_branch_info[i].hive_valid) save_branch_hive( &save_branch_info[i] );
     }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
 
@@ -2152,7 +2978,7 @@ DECL_HANDLER(delete_key)
 
     if ((key = get_hkey_obj( req->hkey, DELETE )))
     {
-        delete_key( key, 0);
+        delete_saved_key( key, 0 );
         release_object( key );
     }
 }
@@ -2285,7 +3111,7 @@ DECL_HANDLER(unload_registry)
 
     if ((key = get_hkey_obj( req->hkey, 0 )))
     {
-        delete_key( key, 1 );     /* FIXME */
+        delete_saved_key( key, 1 );     /* FIXME */
         release_object( key );
     }
 }
@@ -329,23 +329,47 @@ void read_request( struct thread *thread )
 
     if (!thread->req_toread)  /* no pending request */
     {
-        if ((ret = read( get_unix_fd( thread->request_fd ), &thread->req,
-                         sizeof(thread->req) )) != sizeof(thread->req)) goto error;
-        if (!(thread->req_toread = thread->req.request_header.request_size))
+        struct iovec vec[2];
+
+        /* the client doesn't send anything else until it gets the reply, so we can
+         * read the request data in the same system call as the fixed-size part */
+        if (!thread->req_buffer && !(thread->req_buffer = malloc( REQUEST_BUFFER_SIZE )))
+        {
+            fatal_protocol_error( thread, "no memory for request buffer\n" );
+            return;
+        }
+        vec[0].iov_base = &thread->req;
+        vec[0].iov_len  = sizeof(thread->req);
+        vec[1].iov_base = thread->req_buffer;
+        vec[1].iov_len  = REQUEST_BUFFER_SIZE;
+
+        if ((ret = readv( get_unix_fd( thread->request_fd ), vec, 2 )) < (int)sizeof(thread->req))
+            goto error;
+        ret -= sizeof(thread->req);
+        if ((unsigned int)ret > thread->req.request_header.request_size)
         {
-            /* no data, handle request at once */
+            fatal_protocol_error( thread, "request data overflow %d\n", ret );
+            return;
+        }
+        if (!(thread->req_toread = thread->req.request_header.request_size - ret))
+        {
+            /* got everything, handle request at once */
+            thread->req_data = thread->req_buffer;
             call_req_handler( thread );
+            thread->req_data = NULL;
             return;
         }
-        if (!(thread->req_data = malloc( thread->req_toread )))
+        if (!(thread->req_data = malloc( thread->req.request_header.request_size )))
         {
             fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
-                                  thread->req_toread, thread->req.request_header.req );
+                                  thread->req.request_header.request_size,
+                                  thread->req.request_header.req );
             return;
         }
+        memcpy( thread->req_data, thread->req_buffer, ret );
     }
 
-    /* read the variable sized data */
+    /* read the remaining variable sized data */
     for (;;)
     {
         ret = read( get_unix_fd( thread->request_fd ),
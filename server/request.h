@@ -29,6 +29,9 @@
 /* max request length */
 #define MAX_REQUEST_LENGTH  8192
 
+/* size of the per-thread buffer used to read small request data in one go */
+#define REQUEST_BUFFER_SIZE 1024
+
 /* request handler definition */
 #define DECL_HANDLER(name) \
     void req_##name( const struct name##_request *req, struct name##_reply *reply )
@@ -262,6 +265,8 @@ DECL_HANDLER(is_window_hung);
 DECL_HANDLER(get_serial_info);
 DECL_HANDLER(set_serial_info);
 DECL_HANDLER(register_async);
+DECL_HANDLER(register_client_async);
+DECL_HANDLER(wake_client_async);
 DECL_HANDLER(cancel_async);
 DECL_HANDLER(get_async_result);
 DECL_HANDLER(read);
@@ -385,6 +390,7 @@ DECL_HANDLER(remove_completion);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
+DECL_HANDLER(set_fd_completion_mode);
 DECL_HANDLER(set_fd_disp_info);
 DECL_HANDLER(set_fd_name_info);
 DECL_HANDLER(get_window_layered_info);
@@ -558,6 +564,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_get_serial_info,
     (req_handler)req_set_serial_info,
     (req_handler)req_register_async,
+    (req_handler)req_register_client_async,
+    (req_handler)req_wake_client_async,
     (req_handler)req_cancel_async,
     (req_handler)req_get_async_result,
     (req_handler)req_read,
@@ -681,6 +689,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
+    (req_handler)req_set_fd_completion_mode,
     (req_handler)req_set_fd_disp_info,
     (req_handler)req_set_fd_name_info,
     (req_handler)req_get_window_layered_info,
@@ -1002,7 +1011,10 @@ C_ASSERT( FIELD_OFFSET(struct create_file_request, options) == 24 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, attrs) == 28 );
 C_ASSERT( sizeof(struct create_file_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct create_file_reply, handle) == 8 );
-C_ASSERT( sizeof(struct create_file_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct create_file_reply, type) == 12 );
+C_ASSERT( FIELD_OFFSET(struct create_file_reply, access) == 16 );
+C_ASSERT( FIELD_OFFSET(struct create_file_reply, options) == 20 );
+C_ASSERT( sizeof(struct create_file_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_file_object_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct open_file_object_request, attributes) == 16 );
 C_ASSERT( FIELD_OFFSET(struct open_file_object_request, rootdir) == 20 );
@@ -1027,7 +1039,8 @@ C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, type) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, cacheable) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, options) == 20 );
-C_ASSERT( sizeof(struct get_handle_fd_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, comp_flags) == 24 );
+C_ASSERT( sizeof(struct get_handle_fd_reply) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_directory_cache_entry_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_directory_cache_entry_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_directory_cache_entry_reply, entry) == 8 );
@@ -1610,6 +1623,11 @@ C_ASSERT( FIELD_OFFSET(struct register_async_request, type) == 12 );
 C_ASSERT( FIELD_OFFSET(struct register_async_request, async) == 16 );
 C_ASSERT( FIELD_OFFSET(struct register_async_request, count) == 56 );
 C_ASSERT( sizeof(struct register_async_request) == 64 );
+C_ASSERT( FIELD_OFFSET(struct register_client_async_request, async) == 16 );
+C_ASSERT( FIELD_OFFSET(struct register_client_async_request, access) == 56 );
+C_ASSERT( sizeof(struct register_client_async_request) == 64 );
+C_ASSERT( FIELD_OFFSET(struct wake_client_async_request, user) == 16 );
+C_ASSERT( sizeof(struct wake_client_async_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct cancel_async_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct cancel_async_request, iosb) == 16 );
 C_ASSERT( FIELD_OFFSET(struct cancel_async_request, only_thread) == 24 );
@@ -2337,7 +2355,11 @@ C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, status) == 32 );
+C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, async) == 36 );
 C_ASSERT( sizeof(struct add_fd_completion_request) == 40 );
+C_ASSERT( FIELD_OFFSET(struct set_fd_completion_mode_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct set_fd_completion_mode_request, flags) == 16 );
+C_ASSERT( sizeof(struct set_fd_completion_mode_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct set_fd_disp_info_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_fd_disp_info_request, unlink) == 16 );
 C_ASSERT( sizeof(struct set_fd_disp_info_request) == 24 );
@@ -187,6 +187,7 @@ static inline void init_thread_structure( struct thread *thread )
     thread->wait            = NULL;
     thread->error           = 0;
     thread->req_data        = NULL;
+    thread->req_buffer      = NULL;
     thread->req_toread      = 0;
     thread->reply_data      = NULL;
     thread->reply_towrite   = 0;
@@ -282,7 +283,8 @@ static void cleanup_thread( struct thread *thread )
 
     clear_apc_queue( &thread->system_apc );
     clear_apc_queue( &thread->user_apc );
-    free( thread->req_data );
+    if (thread->req_data != thread->req_buffer) free( thread->req_data );
+    free( thread->req_buffer );
     free( thread->reply_data );
     if (thread->request_fd) release_object( thread->request_fd );
     if (thread->reply_fd) release_object( thread->reply_fd );
@@ -301,6 +303,7 @@ static void cleanup_thread( struct thread *thread )
         }
     }
     thread->req_data = NULL;
+    thread->req_buffer = NULL;
     thread->reply_data = NULL;
     thread->request_fd = NULL;
     thread->reply_fd = NULL;
@@ -803,6 +806,47 @@ static int signal_object( obj_handle_t handle )
     return ret;
 }
 
+/* try to satisfy a wait on a single object without building a wait structure */
+/* return 1 if the wait is complete, 0 if it needs to go through the normal path */
+static int try_wait_single_object( obj_handle_t handle, int flags, timeout_t timeout )
+{
+    struct thread_wait wait;
+    struct object *obj;
+    int ret = 0;
+
+    if ((flags & SELECT_INTERRUPTIBLE) && !list_empty( &current->system_apc )) return 0;
+    if (current->process->suspend + current->suspend > 0) return 0;
+    if (!(obj = get_handle_obj( current->process, handle, SYNCHRONIZE, NULL ))) return 1;
+
+    /* objects with a custom add_queue may have side effects when waited upon */
+    if (obj->ops->add_queue == add_queue)
+    {
+        memset( &wait, 0, sizeof(wait) );
+        wait.thread  = current;
+        wait.count   = 1;
+        wait.flags   = flags;
+        wait.select  = SELECT_WAIT;
+        wait.timeout = timeout;
+        wait.queues[0].obj  = obj;
+        wait.queues[0].wait = &wait;
+
+        if (obj->ops->signaled( obj, &wait.queues[0] ))
+        {
+            obj->ops->satisfied( obj, &wait.queues[0] );
+            set_error( wait.abandoned ? STATUS_ABANDONED_WAIT_0 : STATUS_WAIT_0 );
+            ret = 1;
+        }
+        else if (timeout <= current_time &&
+                 !((flags & SELECT_ALERTABLE) && !list_empty( &current->user_apc )))
+        {
+            set_error( STATUS_TIMEOUT );
+            ret = 1;
+        }
+    }
+    release_object( obj );
+    return ret;
+}
+
 /* select on a list of handles */
 static timeout_t select_on( const select_op_t *select_op, data_size_t op_size, client_ptr_t cookie,
                             int flags, timeout_t timeout )
@@ -827,6 +871,9 @@ static timeout_t select_on( const select_op_t *select_op, data_size_t op_size, c
             set_error( STATUS_INVALID_PARAMETER );
             return 0;
         }
+        /* fast path for the common case of an uncontended wait on a single object */
+        if (count == 1 && try_wait_single_object( select_op->wait.handles[0], flags, timeout ))
+            return timeout;
         if (!wait_on_handles( select_op, count, select_op->wait.handles, flags, timeout ))
             return timeout;
         break;
@@ -1747,6 +1747,9 @@ static void dump_create_file_request( const struct create_file_request *req )
 static void dump_create_file_reply( const struct create_file_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", type=%d", req->type );
+    fprintf( stderr, ", access=%08x", req->access );
+    fprintf( stderr, ", options=%08x", req->options );
 }
 
 static void dump_open_file_object_request( const struct open_file_object_request *req )
@@ -1798,6 +1801,7 @@ static void dump_get_handle_fd_reply( const struct get_handle_fd_reply *req )
     fprintf( stderr, ", cacheable=%d", req->cacheable );
     fprintf( stderr, ", access=%08x", req->access );
     fprintf( stderr, ", options=%08x", req->options );
+    fprintf( stderr, ", comp_flags=%08x", req->comp_flags );
 }
 
 static void dump_get_directory_cache_entry_request( const struct get_directory_cache_entry_request *req )
@@ -2937,6 +2941,17 @@ static void dump_register_async_request( const struct register_async_request *re
     fprintf( stderr, ", count=%d", req->count );
 }
 
+static void dump_register_client_async_request( const struct register_client_async_request *req )
+{
+    dump_async_data( " async=", &req->async );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_wake_client_async_request( const struct wake_client_async_request *req )
+{
+    dump_uint64( " user=", &req->user );
+}
+
 static void dump_cancel_async_request( const struct cancel_async_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4395,6 +4410,13 @@ static void dump_add_fd_completion_request( const struct add_fd_completion_reque
     dump_uint64( ", cvalue=", &req->cvalue );
     dump_uint64( ", information=", &req->information );
     fprintf( stderr, ", status=%08x", req->status );
+    fprintf( stderr, ", async=%d", req->async );
+}
+
+static void dump_set_fd_completion_mode_request( const struct set_fd_completion_mode_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", flags=%08x", req->flags );
 }
 
 static void dump_set_fd_disp_info_request( const struct set_fd_disp_info_request *req )
@@ -4693,6 +4715,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_serial_info_request,
     (dump_func)dump_set_serial_info_request,
     (dump_func)dump_register_async_request,
+    (dump_func)dump_register_client_async_request,
+    (dump_func)dump_wake_client_async_request,
     (dump_func)dump_cancel_async_request,
     (dump_func)dump_get_async_result_request,
     (dump_func)dump_read_request,
@@ -4816,6 +4840,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
+    (dump_func)dump_set_fd_completion_mode_request,
     (dump_func)dump_set_fd_disp_info_request,
     (dump_func)dump_set_fd_name_info_request,
     (dump_func)dump_get_window_layered_info_request,
@@ -4987,6 +5012,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     NULL,
+    NULL,
+    NULL,
     (dump_func)dump_get_async_result_reply,
     (dump_func)dump_read_reply,
     (dump_func)dump_write_reply,
@@ -5111,6 +5138,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     NULL,
+    NULL,
     (dump_func)dump_get_window_layered_info_reply,
     NULL,
     (dump_func)dump_alloc_user_handle_reply,
@@ -5279,6 +5307,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "get_serial_info",
     "set_serial_info",
     "register_async",
+    "register_client_async",
+    "wake_client_async",
     "cancel_async",
     "get_async_result",
     "read",
@@ -5402,6 +5432,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "query_completion",
     "set_completion_info",
     "add_fd_completion",
+    "set_fd_completion_mode",
     "set_fd_disp_info",
     "set_fd_name_info",
     "get_window_layered_info",